@@ -0,0 +1,49 @@
+// RoboQuest - A text-based adventure game in C++
+// command.h - Player commands
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <string_view>
+#include "item_catalog.h"
+
+class World;
+
+// Everything a player can ask the game to do
+enum class Verb {
+    UNKNOWN,
+    NORTH,
+    SOUTH,
+    EAST,
+    WEST,
+    LOOK,
+    INVENTORY,
+    TAKE,
+    USE,
+    HELP,
+    QUIT,
+    EXAMINE_PIPELINE,
+    CHECK_VERSION,
+    FIX_BUILD,
+    YES,
+    NO,
+    COUNT
+};
+
+const int VERB_COUNT = static_cast<int>(Verb::COUNT);
+
+// A parsed player command. Parsing never allocates: the argument is a view
+// into the input text, so the input must outlive the command.
+struct Command {
+    Verb verb;
+    ItemId item;               // item for take/use, or ItemId::NONE
+    std::string_view argument; // item name as typed
+};
+
+// Parse a command line such as "north" or "take access_card". Verbs are
+// found through a perfect hash built at compile time, item names through
+// the world's item table. Any other line starting with y or n is a yes or
+// no answer.
+Command parseCommand(std::string_view input, const World& world);
+
+#endif // COMMAND_H
@@ -5,8 +5,23 @@
 #define GAME_H
 
 #include <string>
-#include <map>
 #include <vector>
+#include <memory>
+#include <ostream>
+#include "command.h"
+#include "game_world.h"
+#include "output_sink.h"
+#include "game_state.h"
+#include "json_handler.h"
+#include "replay.h"
+#include "script_vm.h"
+#include "session_clock.h"
+#include "session_task.h"
+#include "world.h"
+
+// Default locations of the world content, relative to the working directory
+const char* const WORLD_IMAGE_PATH = "data/facility.rqw";
+const char* const WORLD_SOURCE_PATH = "data/facility.world";
 
 // Difficulty levels
 enum class Difficulty {
@@ -15,65 +30,105 @@ enum class Difficulty {
     HARD
 };
 
+// Outcome of a single headless step
+struct StepResult {
+    bool recognized;   // the command was understood
+    bool running;      // the session is still in progress
+    bool won;          // the player escaped the facility
+    int score;
+    int timeRemaining;
+};
+
 // Game class to manage the game state and logic
-class Game {
+class Game : private ScriptHost {
 private:
-    // Game state variables
-    bool running;
+    // Session settings
     Difficulty difficulty;
     std::string playerName;
-    int score;
-    int timeRemaining; // in seconds
     
-    // Current player location
-    int playerX;
-    int playerY;
+    // Everything that changes while playing
+    GameState state;
+    
+    // Facility rooms, items, interactions and option menus; shared by
+    // every session on the same world and never changed while playing
+    std::shared_ptr<const GameWorld> facility;
+    
+    // High score storage (optional, not owned)
+    JsonHandler* scoreHandler;
+    
+    // Real-time countdown (optional, not owned); without one each command
+    // costs a second
+    SessionClock* clock;
+    TimerHandle countdown;
     
-    // Map of location descriptions
-    std::map<std::string, std::string> locationDescriptions;
+    // Records each session's commands (optional, not owned)
+    ReplayRecorder* recorder;
     
-    // Player inventory
-    std::map<std::string, bool> inventory;
+    // Game text is formatted into out and reaches the sink once per turn
+    StdoutSink stdoutSink;
+    OutputSink* sink;
+    TurnBuffer turnBuffer;
+    std::ostream out;
     
     // Initialize game components
-    void initializeLocations();
+    bool initializeLocations();
     void initializeItems();
     
     // Game loop helpers
-    void processInput(const std::string& input);
+    void processInput(const Command& command);
+    StepResult play(const Command& command);
+    void prompt();
+    bool waitForInput();
+    uint64_t clockTick() const;
+    void syncTime(uint64_t tick);
+    void addTime(int seconds);
+    void stopCountdown();
+    void finishRecording(ReplayEnd end);
     void updateGameState();
-    void render();
+    
+    // World scripts and what they may do; the VM holds this turn's budget
+    ScriptVM scripts;
+    void runScript(int script);
+    void scriptSay(std::string_view text) override;
+    void scriptAddTime(int seconds) override;
+    void scriptShowMap() override;
     
     // Command handlers
-    void handleMovement(const std::string& direction);
+    void handleMove(Direction direction);
     void handleLook();
     void handleInventory();
-    void handleUse(const std::string& item);
-    void handleTake(const std::string& item);
+    void handleInteraction(const Command& command);
     void handleHelp();
+    void handleQuit();
+    void handleUnknown();
+    void handleTimeout();
     
     // Utility functions
-    std::string getLocationKey(int x, int y);
+    bool carries(ItemId item) const;
     void displayIntroduction();
     void displayEnding(bool success);
+    void displayMap();
     
-    // For dialogue options
-    std::vector<std::string> currentOptions;
-    std::vector<std::string> currentActions;
+    // For dialogue options; the current menu is one of the world's
+    // precomputed ones, or scratchMenu in rooms too busy to have a table
+    OptionMenu scratchMenu;
+    const OptionMenu* currentMenu;
+    void updateAvailableOptions();
     void displayOptions();
     void processOptionSelection(int choice);
-
-    // DevOps command handlers
-    void handleExaminePipeline();
-    void handleCheckVersion();
-    void handleFixBuild();
     
 public:
     // Constructor
     Game();
     
-    // Game initialization
-    void initialize();
+    // Destructor
+    ~Game();
+    
+    // Game initialization; returns false if the world could not be loaded
+    bool initialize();
+    
+    // Start a new session in the already loaded world
+    void reset();
     
     // Set difficulty level
     void setDifficulty(Difficulty level);
@@ -81,9 +136,68 @@ public:
     // Set player name
     void setPlayerName(const std::string& name);
     
-    // Main game loop
+    // Send game text to the given sink instead of standard output
+    void setOutput(OutputSink& target);
+    
+    // Emit the text buffered since the last flush in a single write
+    void flushOutput();
+    
+    // Record final scores in the given handler (nullptr to disable)
+    void setScoreHandler(JsonHandler* handler);
+    
+    // Count down in real time on the given clock (nullptr for one second
+    // per command); takes effect from the next reset
+    void setClock(SessionClock* sessionClock);
+    
+    // End the session because its countdown ran out; called by the clock
+    void expire();
+    
+    // Record every session from the next reset on (nullptr to stop)
+    void setRecorder(ReplayRecorder* replayRecorder);
+    
+    // Identifies the loaded world, so recordings are replayed against it
+    uint32_t worldFingerprint() const;
+    
+    // Play in an already loaded world, e.g. the one another game loaded,
+    // instead of loading one in initialize(). Call it between sessions.
+    void setWorld(std::shared_ptr<const GameWorld> shared);
+    
+    // The loaded world, to share with other games (nullptr before initialize())
+    std::shared_ptr<const GameWorld> sharedWorld() const {
+        return facility;
+    }
+    
+    // Main game loop, reading from standard input
     void run();
     
+    // The whole session as a coroutine that waits on input for every line,
+    // including the answer to the quit question. It shows the introduction
+    // and first menu straight away, flushes the output before each wait,
+    // and ends with the game or when input is closed.
+    SessionTask session(InputChannel& input);
+    
+    // Parse a command line; the result refers into input
+    Command parse(std::string_view input) const;
+    
+    // Execute one command without reading input and flush its output;
+    // used by headless drivers
+    StepResult step(const Command& command);
+    
+    // Write the status block (location, time left, score) to the output
+    void render();
+    
+    // Commands offered by the current menu
+    const std::vector<std::string>& availableActions();
+    
+    // Current session figures
+    int getScore() const;
+    int getTimeRemaining() const;
+    bool hasWon() const;
+    
+    // Capture or replace the whole session state; both are a plain copy
+    GameState snapshot() const;
+    void restore(const GameState& saved);
+    
     // Check if game is running
     bool isRunning() const;
     
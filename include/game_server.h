@@ -0,0 +1,109 @@
+// RoboQuest - A text-based adventure game in C++
+// game_server.h - Hosts many game sessions over sockets (Linux)
+
+#ifndef GAME_SERVER_H
+#define GAME_SERVER_H
+
+#ifdef __linux__
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "json_handler.h"
+#include "replay.h"
+#include "session_clock.h"
+#include "session_task.h"
+#include "world_publisher.h"
+#include "world_watcher.h"
+
+struct ServerOptions {
+    std::string unixPath;            // listen on this Unix socket if set
+    std::string host = "127.0.0.1";  // otherwise on this TCP address
+    int port = 7777;
+    size_t maxLineLength = 1024;     // longer input closes the connection
+    bool watchWorld = false;         // reload the world when its files change
+};
+
+// Runs every session on one thread. Sockets are non-blocking and
+// multiplexed with epoll; each connection keeps its own input and output
+// buffer, and its whole dialogue is a coroutine resumed once per line.
+// The shutdown countdowns of all sessions share one SessionClock.
+//
+// A connection costs a few hundred bytes until the player has picked a
+// difficulty; only then is its Game created. Games share the world that
+// was current when they started; with watchWorld, edits to the world files
+// are published to new games while running ones finish on their version.
+class GameServer {
+private:
+    struct Connection;
+
+    ServerOptions options;
+    int listenFd;
+    int epollFd;
+    int spareFd; // given up to accept and drop a client when out of descriptors
+    std::atomic<bool> stopping;
+    SessionClock clock;
+    WorldPublisher worlds;
+    WorldWatcher watcher;
+    JsonHandler* scoreHandler;
+    ReplayWriter* replayWriter;
+
+    std::vector<std::unique_ptr<Connection>> connections; // by descriptor
+    std::vector<int> dirty;                                // have output to send
+    size_t sessionCount;
+
+    bool listenUnix(std::string& error);
+    bool listenTcp(std::string& error);
+    void acceptClients();
+    void readFrom(Connection& connection);
+    SessionTask serve(Connection& connection);
+    bool startGame(Connection& connection, const std::string& playerName, int choice);
+    void sendPending(Connection& connection);
+    void watchWrites(Connection& connection, bool enable);
+    void closeConnection(int fd);
+    void reloadWorld();
+
+public:
+    explicit GameServer(const ServerOptions& serverOptions);
+    ~GameServer();
+
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+    // Record final scores in the given handler (nullptr to disable)
+    void setScoreHandler(JsonHandler* handler) {
+        scoreHandler = handler;
+    }
+
+    // Record every game to the given writer (nullptr to disable)
+    void setReplayWriter(ReplayWriter* writer) {
+        replayWriter = writer;
+    }
+
+    // Load the world, bind and listen; returns false and fills error on failure
+    bool start(std::string& error);
+
+    // Serve until stop() is called
+    void run();
+
+    // Safe to call from a signal handler
+    void stop() {
+        stopping = true;
+    }
+
+    // Open connections
+    size_t sessions() const {
+        return sessionCount;
+    }
+
+    // Counts world versions published, 1 after start()
+    uint64_t worldVersion() const {
+        return worlds.version();
+    }
+};
+
+#endif // __linux__
+
+#endif // GAME_SERVER_H
@@ -0,0 +1,56 @@
+// RoboQuest - A text-based adventure game in C++
+// game_state.h - Compact, trivially copyable session state
+
+#ifndef GAME_STATE_H
+#define GAME_STATE_H
+
+#include <cstdint>
+#include <type_traits>
+#include "item_catalog.h"
+
+// Session flags stored in GameState::flags
+enum GameFlag : uint32_t {
+    FLAG_RUNNING = 1u << 0,
+    FLAG_ESCAPED = 1u << 1,
+    FLAG_QUIT_PENDING = 1u << 2, // waiting for the quit confirmation
+    FLAG_EXIT_UNLOCKED = 1u << 3
+};
+
+// Most seconds a countdown may hold either way; bonuses saturate here
+const int32_t MAX_TIME_REMAINING = 24 * 60 * 60;
+
+// Counters the world's scripts keep for each session
+const int SESSION_COUNTER_COUNT = 8;
+
+// Everything that changes during a session. It holds no pointers or
+// containers, so copying it is a plain memcpy and a saved copy can be
+// restored into any Game that uses the same world.
+struct GameState {
+    int32_t room;          // index into the world's rooms
+    int32_t score;
+    int32_t timeRemaining; // in seconds
+    uint32_t flags;        // GameFlag bits
+    ItemSet inventory;     // items the player carries
+    int32_t counters[SESSION_COUNTER_COUNT];
+
+    bool hasFlag(uint32_t flag) const {
+        return (flags & flag) != 0;
+    }
+
+    void setFlag(uint32_t flag) {
+        flags |= flag;
+    }
+
+    void clearFlag(uint32_t flag) {
+        flags &= ~flag;
+    }
+
+    void clearCounters() {
+        for (int i = 0; i < SESSION_COUNTER_COUNT; i++) counters[i] = 0;
+    }
+};
+
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState must stay trivially copyable");
+static_assert(sizeof(GameState) == 16 + MAX_ITEMS / 8 + 4 * SESSION_COUNTER_COUNT, "GameState layout changed");
+
+#endif // GAME_STATE_H
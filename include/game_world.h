@@ -0,0 +1,62 @@
+// RoboQuest - A text-based adventure game in C++
+// game_world.h - A loaded world and everything the game derives from it
+
+#ifndef GAME_WORLD_H
+#define GAME_WORLD_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "item_catalog.h"
+#include "option_menus.h"
+#include "rule_table.h"
+#include "world.h"
+
+// The static part of the game: rooms, descriptions, exits, item placement,
+// the interaction rules, the items the hints refer to by name, and every
+// option menu. Nothing in it changes once loaded, so one instance is
+// shared, reference-counted, by every session playing that world; what a
+// session changes (position, items taken, doors unlocked) lives in its
+// GameState. Pinned in memory, since the catalog, the rules and the menus
+// point into the world.
+class GameWorld {
+public:
+    World world;
+    ItemCatalog items;
+
+    // Items the hints refer to (ItemId::NONE if absent)
+    ItemId accessCard;
+    ItemId powerCell;
+    ItemId debuggingAbility;
+    ItemSet hintItems;
+
+    RuleTable rules;
+    OptionMenus menus;
+
+    // Constructor
+    GameWorld();
+
+    GameWorld(const GameWorld&) = delete;
+    GameWorld& operator=(const GameWorld&) = delete;
+
+    // Map a compiled image, or compile the source if the image cannot be
+    // used; returns nullptr and fills error, one line per attempt, if
+    // neither works
+    static std::shared_ptr<const GameWorld> load(const std::string& imagePath, const std::string& sourcePath,
+                                                 std::string& error);
+
+    // Compile a source file into a world held in memory
+    static std::shared_ptr<const GameWorld> compile(const std::string& sourcePath, std::string& error);
+
+    // Take a compiled image that is already in memory. Worlds that replace
+    // others while sessions still play the old ones are read this way, so
+    // no version depends on the file staying as it was.
+    static std::shared_ptr<const GameWorld> fromImage(std::vector<char> image, std::string& error);
+
+private:
+    // Check the scripts, resolve items and rules and build the menus once
+    // the world is loaded
+    bool prepare(std::string& error);
+};
+
+#endif // GAME_WORLD_H
@@ -0,0 +1,141 @@
+// RoboQuest - A text-based adventure game in C++
+// item_catalog.h - Typed item IDs, inventory bitsets and the item catalog
+
+#ifndef ITEM_CATALOG_H
+#define ITEM_CATALOG_H
+
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+
+class World;
+struct WorldItemRecord;
+
+// Maximum number of items a world may define
+const int MAX_ITEMS = 256;
+
+// Dense item ID assigned by the world compiler (the item's index)
+enum class ItemId : int32_t {
+    NONE = -1
+};
+
+inline int itemIndex(ItemId item) {
+    return static_cast<int>(item);
+}
+
+// Fixed-width set of items. Ownership tests are a shift and a mask, and
+// predicates over several items ("has A and not B") are whole-set mask
+// operations. Trivially copyable, so it can live inside GameState.
+class ItemSet {
+private:
+    static const int WORD_BITS = 64;
+    static const int WORD_COUNT = MAX_ITEMS / WORD_BITS;
+    uint64_t words[WORD_COUNT];
+
+public:
+    ItemSet() : words{} {
+    }
+
+    ItemSet(std::initializer_list<ItemId> items) : words{} {
+        for (ItemId item : items) {
+            add(item);
+        }
+    }
+
+    bool has(ItemId item) const {
+        int index = itemIndex(item);
+        return (words[index / WORD_BITS] >> (index % WORD_BITS)) & 1u;
+    }
+
+    void add(ItemId item) {
+        int index = itemIndex(item);
+        words[index / WORD_BITS] |= uint64_t(1) << (index % WORD_BITS);
+    }
+
+    void remove(ItemId item) {
+        int index = itemIndex(item);
+        words[index / WORD_BITS] &= ~(uint64_t(1) << (index % WORD_BITS));
+    }
+
+    void clear() {
+        for (int i = 0; i < WORD_COUNT; i++) words[i] = 0;
+    }
+
+    void addAll(const ItemSet& items) {
+        for (int i = 0; i < WORD_COUNT; i++) words[i] |= items.words[i];
+    }
+
+    void removeAll(const ItemSet& items) {
+        for (int i = 0; i < WORD_COUNT; i++) words[i] &= ~items.words[i];
+    }
+
+    bool empty() const {
+        uint64_t any = 0;
+        for (int i = 0; i < WORD_COUNT; i++) any |= words[i];
+        return any == 0;
+    }
+
+    // Every item in required is present and none in forbidden is
+    bool matches(const ItemSet& required, const ItemSet& forbidden) const {
+        uint64_t mismatch = 0;
+        for (int i = 0; i < WORD_COUNT; i++) {
+            mismatch |= (words[i] & required.words[i]) ^ required.words[i];
+            mismatch |= words[i] & forbidden.words[i];
+        }
+        return mismatch == 0;
+    }
+
+    bool containsAll(const ItemSet& items) const {
+        return matches(items, ItemSet());
+    }
+
+    bool containsAny(const ItemSet& items) const {
+        uint64_t common = 0;
+        for (int i = 0; i < WORD_COUNT; i++) common |= words[i] & items.words[i];
+        return common != 0;
+    }
+
+    bool operator==(const ItemSet& other) const {
+        uint64_t difference = 0;
+        for (int i = 0; i < WORD_COUNT; i++) difference |= words[i] ^ other.words[i];
+        return difference == 0;
+    }
+
+    bool operator!=(const ItemSet& other) const {
+        return !(*this == other);
+    }
+
+    // Raw words, for hashing
+    uint64_t word(int index) const {
+        return words[index];
+    }
+
+    static int wordCount() {
+        return WORD_COUNT;
+    }
+};
+
+// Typed view of a world's item table
+class ItemCatalog {
+private:
+    const World* world;
+
+public:
+    ItemCatalog() : world(nullptr) {
+    }
+
+    explicit ItemCatalog(const World& items) : world(&items) {
+    }
+
+    int size() const;
+
+    // Item by key, or ItemId::NONE
+    ItemId find(std::string_view key) const;
+
+    const WorldItemRecord& record(ItemId item) const;
+
+    std::string_view key(ItemId item) const;
+    std::string_view name(ItemId item) const;
+};
+
+#endif // ITEM_CATALOG_H
@@ -1,4 +1,6 @@
-// Create a new file: include/json_handler.h
+// RoboQuest - A text-based adventure game in C++
+// json_handler.h - High score storage on top of the binary score store
+
 #ifndef JSON_HANDLER_H
 #define JSON_HANDLER_H
 
@@ -7,116 +9,278 @@
 #include <fstream>
 #include <iostream>
 #include <ctime>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include "leaderboard.h"
+#include "score_store.h"
 
-struct ScoreEntry {
-    std::string playerName;
-    int score;
-    std::string difficulty;
-    std::string date;
-};
+// First line of score logs written by the previous text format. Such logs
+// can still be imported into a score store with importLog().
+const char* const SCORE_LOG_HEADER = "#RoboQuest score log v1";
+
+// Scores appended after the last index build before startup rebuilds it
+const uint32_t SCORE_REINDEX_THRESHOLD = 4096;
+
+// How often saved scores are forced to disk. Scores saved within one
+// interval share a sync, and closing the store syncs whatever is left.
+const int SCORE_SYNC_INTERVAL_MS = 200;
 
+// Keeps the high score list in a binary ScoreStore. Saving a score appends
+// one record; loading reads only the leaders through the store's index.
 class JsonHandler {
 private:
-    std::string filePath;
-    std::vector<ScoreEntry> scores;
-    
-    std::string getCurrentDate() {
-        time_t now = time(0);
-        struct tm* timeinfo = localtime(&now);
+    ScoreStore store;
+    Leaderboard leaderboard;
+
+    static std::string formatDate(int64_t timestamp) {
+        time_t seconds = static_cast<time_t>(timestamp);
+        struct tm* timeinfo = localtime(&seconds);
         char buffer[80];
         strftime(buffer, 80, "%Y-%m-%d %H:%M:%S", timeinfo);
         return std::string(buffer);
     }
-    
+
+    // Parse "YYYY-MM-DD HH:MM:SS" in local time; 0 if unreadable
+    static int64_t parseDate(const std::string& date) {
+        struct tm timeinfo = {};
+        if (std::sscanf(date.c_str(), "%d-%d-%d %d:%d:%d",
+                        &timeinfo.tm_year, &timeinfo.tm_mon, &timeinfo.tm_mday,
+                        &timeinfo.tm_hour, &timeinfo.tm_min, &timeinfo.tm_sec) != 6) {
+            return 0;
+        }
+        timeinfo.tm_year -= 1900;
+        timeinfo.tm_mon -= 1;
+        timeinfo.tm_isdst = -1;
+        return static_cast<int64_t>(mktime(&timeinfo));
+    }
+
+    // Reads the valid lines of a text score log as records, a batch at a time
+    struct LogReader {
+        std::ifstream file;
+        std::string lastDate;
+        int64_t lastTimestamp = 0;
+
+        explicit LogReader(const std::string& path) : file(path) {
+        }
+
+        // Fill batch with up to 65536 records; false once the log is exhausted
+        bool next(std::vector<ScoreRecord>& batch) {
+            batch.reserve(65536);
+            std::string line;
+            ScoreEntry entry;
+            while (batch.size() < batch.capacity()) {
+                if (!std::getline(file, line)) {
+                    return false;
+                }
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+
+                ScoreDifficulty level;
+                if (line.empty() || line[0] == '#' || !parseLine(line, entry) ||
+                    !parseScoreDifficulty(entry.difficulty, level)) {
+                    continue;
+                }
+                if (entry.date != lastDate) { // logs are in time order, so dates repeat
+                    lastDate = entry.date;
+                    lastTimestamp = parseDate(entry.date);
+                }
+                batch.push_back(makeScoreRecord(entry.playerName, entry.score, level, lastTimestamp));
+            }
+            return true;
+        }
+    };
+
+    long import(const std::string& logPath, bool onlyIfEmpty) {
+        LogReader reader(logPath);
+        if (!reader.file.is_open() || !store.isOpen()) {
+            return -1;
+        }
+
+        std::string error;
+        uint64_t imported = 0;
+        if (onlyIfEmpty) {
+            store.appendIfEmpty([&reader](std::vector<ScoreRecord>& batch) {
+                return reader.next(batch);
+            }, imported, error);
+        } else {
+            std::vector<ScoreRecord> batch;
+            bool more = true;
+            while (more && error.empty()) {
+                batch.clear();
+                more = reader.next(batch);
+                if (store.appendAll(batch, error)) {
+                    imported += batch.size();
+                }
+            }
+        }
+        if (!error.empty()) {
+            std::cerr << "Error: " << error << std::endl;
+        }
+
+        if (imported > 0) {
+            compact();
+            loadScores();
+        }
+        return static_cast<long>(imported);
+    }
+
 public:
-    JsonHandler(const std::string& path) : filePath(path) {
+    JsonHandler(const std::string& path) {
+        std::string error;
+        store.setDurability(ScoreDurability::BATCHED, SCORE_SYNC_INTERVAL_MS);
+        if (!store.open(path, error)) {
+            std::cerr << "Error: " << error << std::endl;
+        }
+        else if (store.droppedOnOpen() > 0) {
+            std::cerr << "Warning: removed " << store.droppedOnOpen()
+                      << " damaged scores from the end of " << path << std::endl;
+        }
         loadScores();
     }
-    
+
+    // Trade durability for speed, e.g. EVERY_WRITE when each score matters
+    void setDurability(ScoreDurability mode, int intervalMilliseconds = SCORE_SYNC_INTERVAL_MS) {
+        store.setDurability(mode, intervalMilliseconds);
+    }
+
+    // Parse "name,score,difficulty,date"; returns false for damaged lines
+    static bool parseLine(const std::string& line, ScoreEntry& entry) {
+        size_t nameEnd = line.find(',');
+        if (nameEnd == std::string::npos) return false;
+
+        size_t scoreEnd = line.find(',', nameEnd + 1);
+        if (scoreEnd == std::string::npos) return false;
+
+        size_t diffEnd = line.find(',', scoreEnd + 1);
+        if (diffEnd == std::string::npos) return false;
+
+        std::string scoreText = line.substr(nameEnd + 1, scoreEnd - nameEnd - 1);
+        char* end = nullptr;
+        long score = std::strtol(scoreText.c_str(), &end, 10);
+        if (scoreText.empty() || *end != '\0') return false;
+
+        entry.playerName = line.substr(0, nameEnd);
+        entry.score = static_cast<int>(score);
+        entry.difficulty = line.substr(scoreEnd + 1, diffEnd - scoreEnd - 1);
+        entry.date = line.substr(diffEnd + 1);
+        return true;
+    }
+
+    static ScoreEntry toEntry(const ScoreRecord& record) {
+        ScoreEntry entry;
+        entry.playerName = scoreRecordName(record);
+        entry.score = record.score;
+        entry.difficulty = scoreDifficultyName(static_cast<ScoreDifficulty>(record.difficulty));
+        entry.date = formatDate(record.timestamp);
+        return entry;
+    }
+
+    // Rebuild the in-memory leaders from the store. Each difficulty's top
+    // records come from the index; they are offered in append order so
+    // equal scores rank the same way they did when they were saved.
     void loadScores() {
-        scores.clear();
-        
-        std::ifstream file(filePath);
-        if (!file.is_open()) {
+        leaderboard.clear();
+        if (!store.isOpen()) {
             return;
         }
-        
-        // Simple parsing of our custom format
-        std::string line;
-        while (std::getline(file, line)) {
-            size_t nameEnd = line.find(',');
-            if (nameEnd == std::string::npos) continue;
-            
-            std::string name = line.substr(0, nameEnd);
-            
-            size_t scoreEnd = line.find(',', nameEnd + 1);
-            if (scoreEnd == std::string::npos) continue;
-            
-            int score = std::stoi(line.substr(nameEnd + 1, scoreEnd - nameEnd - 1));
-            
-            size_t diffEnd = line.find(',', scoreEnd + 1);
-            if (diffEnd == std::string::npos) continue;
-            
-            std::string difficulty = line.substr(scoreEnd + 1, diffEnd - scoreEnd - 1);
-            std::string date = line.substr(diffEnd + 1);
-            
-            scores.push_back({name, score, difficulty, date});
-        }
-        
-        file.close();
-    }
-    
-    void saveScore(const std::string& playerName, int score, const std::string& difficulty) {
-        ScoreEntry entry;
-        entry.playerName = playerName;
-        entry.score = score;
-        entry.difficulty = difficulty;
-        entry.date = getCurrentDate();
-        
-        scores.push_back(entry);
-        
-        // Save to file
-        std::ofstream file(filePath);
-        if (!file.is_open()) {
-            std::cerr << "Error: Could not open file for writing: " << filePath << std::endl;
+
+        std::string error;
+        if (!store.refresh(error)) {
+            std::cerr << "Error: " << error << std::endl;
             return;
         }
-        
-        for (const auto& entry : scores) {
-            file << entry.playerName << "," 
-                 << entry.score << "," 
-                 << entry.difficulty << "," 
-                 << entry.date << std::endl;
+
+        std::vector<uint32_t> leaders;
+        std::vector<uint32_t> ranked;
+        for (int i = 0; i < SCORE_DIFFICULTY_COUNT; i++) {
+            store.top(static_cast<ScoreDifficulty>(i), leaderboard.listSize(), ranked);
+            leaders.insert(leaders.end(), ranked.begin(), ranked.end());
+        }
+        std::sort(leaders.begin(), leaders.end());
+        for (uint32_t number : leaders) {
+            leaderboard.insert(toEntry(store.record(number)));
+        }
+    }
+
+    // Append one score to the store; returns false if it could not be written
+    bool saveScore(const std::string& playerName, int score, const std::string& difficulty) {
+        ScoreDifficulty level = SCORE_NORMAL;
+        parseScoreDifficulty(difficulty, level);
+        ScoreRecord record = makeScoreRecord(playerName, score, level, static_cast<int64_t>(time(0)));
+
+        std::string error;
+        if (!store.isOpen() || !store.append(record, error)) {
+            std::cerr << "Error: Could not save score: " << error << std::endl;
+            return false;
+        }
+        leaderboard.insert(toEntry(record));
+        return true;
+    }
+
+    // True if enough scores were saved since the index was built that
+    // queries spend noticeable time scanning them
+    bool needsCompaction() const {
+        return store.isOpen() && store.unindexedCount() > SCORE_REINDEX_THRESHOLD;
+    }
+
+    // Rebuild the index over every record
+    bool compact() {
+        std::string error;
+        if (!store.buildIndex(error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return false;
         }
-        
-        file.close();
+        return true;
+    }
+
+    bool isEmpty() const {
+        return store.recordCount() == 0;
+    }
+
+    // Append every valid line of a text score log, then rebuild the index.
+    // Returns the number of scores imported, or -1 if the log is missing.
+    long importLog(const std::string& logPath) {
+        return import(logPath, false);
+    }
+
+    // The same, but only into a store with no scores yet. The check and
+    // the import happen under one hold of the store lock, so games started
+    // together on a fresh store import the log once between them.
+    long importLogIfEmpty(const std::string& logPath) {
+        return import(logPath, true);
     }
-    
-    void displayHighScores() {
-        if (scores.empty()) {
-            std::cout << "No high scores yet!" << std::endl;
+
+    // Best scores overall, or for one difficulty ("Easy", "Normal", "Hard")
+    const std::vector<ScoreEntry>& topScores() const {
+        return leaderboard.top();
+    }
+
+    const std::vector<ScoreEntry>& topScores(const std::string& difficulty) const {
+        return leaderboard.top(difficulty);
+    }
+
+    const ScoreStore& scoreStore() const {
+        return store;
+    }
+
+    void displayHighScores(std::ostream& out = std::cout) {
+        const std::vector<ScoreEntry>& top = leaderboard.top(); // top 5, highest first
+        if (top.empty()) {
+            out << "No high scores yet!" << std::endl;
             return;
         }
-        
-        // Sort scores (highest first)
-        std::sort(scores.begin(), scores.end(), 
-                 [](const ScoreEntry& a, const ScoreEntry& b) {
-                     return a.score > b.score;
-                 });
-        
-        std::cout << "\n===== HIGH SCORES =====\n";
+
+        out << "\n===== HIGH SCORES =====\n";
         int count = 0;
-        for (const auto& entry : scores) {
-            std::cout << (count + 1) << ". " << entry.playerName 
-                     << " - " << entry.score << " points"
-                     << " (" << entry.difficulty << ")"
-                     << " on " << entry.date << std::endl;
-            
+        for (const auto& entry : top) {
+            out << (count + 1) << ". " << entry.playerName
+                << " - " << entry.score << " points"
+                << " (" << entry.difficulty << ")"
+                << " on " << entry.date << std::endl;
             count++;
-            if (count >= 5) break; // Show only top 5
         }
-        std::cout << "======================\n";
+        out << "======================\n";
     }
 };
 
-#endif // JSON_HANDLER_H
\ No newline at end of file
+#endif // JSON_HANDLER_H
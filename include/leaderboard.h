@@ -0,0 +1,103 @@
+// RoboQuest - A text-based adventure game in C++
+// leaderboard.h - Incrementally maintained top-K score lists
+
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct ScoreEntry {
+    std::string playerName;
+    int score;
+    std::string difficulty;
+    std::string date;
+};
+
+// Best K scores overall and per difficulty, each kept as a small sorted
+// array. Inserting costs O(K) and copies the entry only if it makes a list,
+// so loading any number of scores needs O(K) memory and reading a list
+// needs no sorting. Equal scores keep their insertion order.
+class Leaderboard {
+private:
+    struct Board {
+        std::string difficulty;
+        std::vector<ScoreEntry> entries;
+    };
+
+    size_t capacity;
+    size_t total;
+    std::vector<ScoreEntry> overall;
+    std::vector<Board> boards; // one per difficulty seen so far
+
+    // Insert into one sorted list, dropping whatever falls off the end
+    void insertInto(std::vector<ScoreEntry>& entries, const ScoreEntry& entry) {
+        if (capacity == 0) {
+            return;
+        }
+        if (entries.size() >= capacity && entry.score <= entries.back().score) {
+            return;
+        }
+        size_t position = entries.size();
+        while (position > 0 && entries[position - 1].score < entry.score) {
+            position--;
+        }
+        entries.insert(entries.begin() + position, entry);
+        if (entries.size() > capacity) {
+            entries.pop_back();
+        }
+    }
+
+public:
+    explicit Leaderboard(size_t k = 5) : capacity(k), total(0) {
+    }
+
+    void insert(const ScoreEntry& entry) {
+        total++;
+        insertInto(overall, entry);
+
+        for (auto& board : boards) {
+            if (board.difficulty == entry.difficulty) {
+                insertInto(board.entries, entry);
+                return;
+            }
+        }
+        boards.push_back({entry.difficulty, std::vector<ScoreEntry>()});
+        boards.back().entries.reserve(capacity + 1);
+        insertInto(boards.back().entries, entry);
+    }
+
+    void clear() {
+        total = 0;
+        overall.clear();
+        boards.clear();
+    }
+
+    // Best scores across all difficulties, highest first
+    const std::vector<ScoreEntry>& top() const {
+        return overall;
+    }
+
+    // Best scores for one difficulty, highest first
+    const std::vector<ScoreEntry>& top(const std::string& difficulty) const {
+        static const std::vector<ScoreEntry> none;
+        for (const auto& board : boards) {
+            if (board.difficulty == difficulty) {
+                return board.entries;
+            }
+        }
+        return none;
+    }
+
+    // Number of scores inserted
+    size_t size() const {
+        return total;
+    }
+
+    size_t listSize() const {
+        return capacity;
+    }
+};
+
+#endif // LEADERBOARD_H
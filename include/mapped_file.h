@@ -0,0 +1,49 @@
+// RoboQuest - A text-based adventure game in C++
+// mapped_file.h - Read-only memory-mapped files
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Maps a whole file read-only into memory. Pages are loaded lazily by the
+// OS and shared between every process that maps the same file.
+class MappedFile {
+private:
+    const char* mappedData;
+    size_t mappedSize;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Map the file at path; returns false and fills error on failure
+    bool open(const std::string& path, std::string& error);
+
+    // Unmap the file
+    void close();
+
+    bool isOpen() const {
+        return mappedData != nullptr;
+    }
+
+    const char* data() const {
+        return mappedData;
+    }
+
+    size_t size() const {
+        return mappedSize;
+    }
+};
+
+#endif // MAPPED_FILE_H
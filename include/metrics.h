@@ -0,0 +1,154 @@
+// RoboQuest - A text-based adventure game in C++
+// metrics.h - Turn and score-store instrumentation
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "command.h"
+
+// Instrumentation is compiled in only when ROBOQUEST_METRICS is defined
+// (cmake -DROBOQUEST_METRICS=ON). Without it the probes below are empty
+// inline classes, so the game pays nothing, and the counters stay zero.
+#ifdef ROBOQUEST_METRICS
+const bool METRICS_ENABLED = true;
+#else
+const bool METRICS_ENABLED = false;
+#endif
+
+// Histogram of non-negative values in power-of-two buckets: bucket 0 holds
+// 0, bucket i holds [2^(i-1), 2^i). Recording is two relaxed atomic adds,
+// so any number of threads may record and read at once without locks.
+class alignas(64) MetricHistogram {
+public:
+    static constexpr int BUCKET_COUNT = 65;
+
+private:
+    std::atomic<uint64_t> buckets[BUCKET_COUNT]; // together they are the count
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> largest;
+
+public:
+    // Constructor; constexpr so the global counters need no static init
+    constexpr MetricHistogram() : buckets{}, sum(0), largest(0) {
+    }
+
+    void record(uint64_t value);
+
+    uint64_t count() const;
+
+    uint64_t valueSum() const {
+        return sum.load(std::memory_order_relaxed);
+    }
+
+    uint64_t max() const {
+        return largest.load(std::memory_order_relaxed);
+    }
+
+    double mean() const;
+
+    // Upper bound of the bucket holding the given fraction (0..1) of values
+    uint64_t percentile(double fraction) const;
+
+    void reset();
+};
+
+// Every counter the game keeps. Latencies are in nanoseconds.
+struct Metrics {
+    MetricHistogram turnLatency[VERB_COUNT]; // per command type; counts turns
+    MetricHistogram allocationsPerTurn;      // heap allocations in a turn
+    MetricHistogram outputBytesPerTurn;      // game text written in a turn
+    MetricHistogram scoreWriteLatency;       // one ScoreStore append, sync included
+    MetricHistogram scoreRecordsPerWrite;    // records a write leader appended
+};
+
+// The process-wide counters
+Metrics& metrics();
+
+// Zero every counter
+void resetMetrics();
+
+// Human-readable table, or one JSON object
+void writeMetricsText(std::ostream& out);
+void writeMetricsJson(std::ostream& out);
+
+// Write to a file: JSON if the path ends in ".json", text otherwise, and
+// "-" for standard error
+bool writeMetricsFile(const std::string& path, std::string& error);
+
+// Write to a file with writeMetricsFile() when the process exits
+void dumpMetricsAtExit(const std::string& path);
+
+// Heap allocations made by the calling thread so far. Defined, along with
+// the counting operator new, in allocation_counter.cpp, which only
+// ROBOQUEST_METRICS builds and the benchmarks link in.
+uint64_t threadAllocationCount();
+
+#ifdef ROBOQUEST_METRICS
+
+// Measures one turn from construction to finish()
+class TurnProbe {
+private:
+    std::chrono::steady_clock::time_point start;
+    uint64_t allocations;
+    size_t outputStart;
+
+public:
+    explicit TurnProbe(size_t outputSize) :
+        start(std::chrono::steady_clock::now()),
+        allocations(threadAllocationCount()),
+        outputStart(outputSize) {
+    }
+
+    void finish(Verb verb, size_t outputSize) {
+        Metrics& all = metrics();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        all.turnLatency[static_cast<int>(verb)].record(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        all.allocationsPerTurn.record(threadAllocationCount() - allocations);
+        all.outputBytesPerTurn.record(outputSize >= outputStart ? outputSize - outputStart : outputSize);
+    }
+};
+
+// Measures one score-store write from construction to finish()
+class ScoreWriteProbe {
+private:
+    std::chrono::steady_clock::time_point start;
+
+public:
+    ScoreWriteProbe() : start(std::chrono::steady_clock::now()) {
+    }
+
+    void finish(size_t records) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        metrics().scoreWriteLatency.record(
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        metrics().scoreRecordsPerWrite.record(records);
+    }
+};
+
+#else
+
+class TurnProbe {
+public:
+    explicit TurnProbe(size_t) {
+    }
+
+    void finish(Verb, size_t) {
+    }
+};
+
+class ScoreWriteProbe {
+public:
+    void finish(size_t) {
+    }
+};
+
+#endif // ROBOQUEST_METRICS
+
+#endif // METRICS_H
@@ -0,0 +1,25 @@
+// RoboQuest - A text-based adventure game in C++
+// name_hash.h - Seeded string hash shared by compile-time and runtime tables
+
+#ifndef NAME_HASH_H
+#define NAME_HASH_H
+
+#include <cstdint>
+#include <string_view>
+
+// FNV-1a with a seed folded into the offset basis and a final avalanche.
+// Perfect hash tables pick the first seed that maps their keys to distinct
+// slots, so the same function must be used to build and to probe them.
+constexpr uint32_t nameHash(std::string_view text, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (size_t i = 0; i < text.size(); i++) {
+        hash ^= static_cast<unsigned char>(text[i]);
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x7FEB352Du;
+    hash ^= hash >> 15;
+    return hash;
+}
+
+#endif // NAME_HASH_H
@@ -0,0 +1,74 @@
+// RoboQuest - A text-based adventure game in C++
+// option_menus.h - Precomputed option menus for every room and inventory
+
+#ifndef OPTION_MENUS_H
+#define OPTION_MENUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "command.h"
+#include "item_catalog.h"
+
+class RuleTable;
+class World;
+
+// One option menu: the choices shown and the command each one runs
+struct OptionMenu {
+    std::vector<std::string> labels;  // e.g. "Go north"
+    std::vector<std::string> actions; // command text, e.g. "north"
+    std::vector<Command> commands;    // actions parsed; arguments view into actions
+};
+
+// Every option menu a world can show. A room's menu depends only on the
+// few items and flags its rules test. Each room gets a table with a menu
+// for every combination of them, built once with the world, so finding
+// the menu for a turn is a couple of array lookups and builds no strings.
+// Immutable after build(), so any number of sessions on any threads may
+// share one.
+class OptionMenus {
+public:
+    // Rooms whose menu depends on more items and flags than this have no
+    // table; their menu is composed each turn instead
+    static constexpr int MAX_TABLE_ITEMS = 10;
+
+private:
+    static constexpr size_t NO_TABLE = SIZE_MAX;
+
+    struct RoomTable {
+        std::vector<ItemId> items;   // the items the menu depends on
+        std::vector<uint32_t> flags; // the flags it depends on, after the items
+        size_t first;                // index of the menu for none of them, or NO_TABLE
+    };
+
+    const World* world;
+    const RuleTable* rules;
+    std::vector<RoomTable> rooms;
+    std::vector<OptionMenu> menus;
+
+public:
+    // Constructor
+    OptionMenus();
+
+    OptionMenus(const OptionMenus&) = delete;
+    OptionMenus& operator=(const OptionMenus&) = delete;
+
+    // Build every table for a loaded world and its rules, which must
+    // outlive the menus
+    void build(const World& source, const RuleTable& roomRules);
+
+    // The menu for a room, inventory and GameFlag bits. Rooms without a
+    // table have their menu composed into scratch, which is then returned.
+    const OptionMenu& find(int room, const ItemSet& inventory, uint32_t flags, OptionMenu& scratch) const;
+
+    // Compose a menu from the world, as the tables were
+    void compose(int room, const ItemSet& inventory, uint32_t flags, OptionMenu& menu) const;
+
+    // Menus held in tables
+    size_t size() const {
+        return menus.size();
+    }
+};
+
+#endif // OPTION_MENUS_H
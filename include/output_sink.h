@@ -0,0 +1,107 @@
+// RoboQuest - A text-based adventure game in C++
+// output_sink.h - Destinations for game text and the per-turn buffer
+
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <cstddef>
+#include <streambuf>
+#include <string>
+
+// Receives a turn's worth of game text in a single call
+class OutputSink {
+public:
+    virtual ~OutputSink() {}
+
+    virtual void write(const char* data, size_t size) = 0;
+
+    // Sinks that drop everything let the game skip formatting altogether
+    virtual bool discards() const {
+        return false;
+    }
+};
+
+// Standard output, one write per turn
+class StdoutSink : public OutputSink {
+public:
+    void write(const char* data, size_t size) override;
+};
+
+// Collects text in memory, e.g. for tests or for sending elsewhere later
+class MemorySink : public OutputSink {
+private:
+    std::string text;
+
+public:
+    void write(const char* data, size_t size) override {
+        text.append(data, size);
+    }
+
+    const std::string& contents() const {
+        return text;
+    }
+
+    void clear() {
+        text.clear();
+    }
+};
+
+// Drops all output; used by headless runs
+class NullSink : public OutputSink {
+public:
+    void write(const char*, size_t) override {
+    }
+
+    bool discards() const override {
+        return true;
+    }
+};
+
+#ifndef _WIN32
+// Writes to a blocking file descriptor such as a pipe or socket
+class DescriptorSink : public OutputSink {
+private:
+    int fd;
+
+public:
+    explicit DescriptorSink(int descriptor) : fd(descriptor) {
+    }
+
+    void write(const char* data, size_t size) override;
+};
+#endif
+
+// Stream buffer that accumulates text until the turn ends. Flushing the
+// stream (std::flush, std::endl) does nothing; only emit() hands the text
+// to the sink.
+class TurnBuffer : public std::streambuf {
+private:
+    std::string pending;
+    OutputSink* sink;
+
+protected:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* data, std::streamsize size) override;
+    int sync() override {
+        return 0;
+    }
+
+public:
+    // pending grows to the longest turn's text and keeps that capacity, so
+    // a session that has printed nothing costs no buffer at all
+    TurnBuffer() : sink(nullptr) {
+    }
+
+    void setSink(OutputSink* target) {
+        sink = target;
+    }
+
+    // Send the pending text to the sink in one write
+    void emit();
+
+    size_t size() const {
+        return pending.size();
+    }
+};
+
+#endif // OUTPUT_SINK_H
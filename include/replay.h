@@ -0,0 +1,160 @@
+// RoboQuest - A text-based adventure game in C++
+// replay.h - Compact session recordings and deterministic replay
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "command.h"
+#include "game_state.h"
+
+class Game;
+class SessionClock;
+
+// ---------------------------------------------------------------------------
+// Replay file layout
+//
+//   ReplayFileHeader
+//   session blocks, each: varint length, then length bytes of
+//     uint32_t worldFingerprint            (fixed width)
+//     varint difficulty, varint flags, varint start time (Unix seconds)
+//     varint name length, name bytes
+//     commands, each: varint verb + 1
+//                     [varint item + 1]   (take and use only)
+//                     [varint tick delta] (REPLAY_REAL_TIME only)
+//     0, then the end: varint ReplayEnd, [varint tick delta],
+//                      zigzag score, zigzag time remaining,
+//                      uint32_t state hash  (fixed width)
+//
+// Varints are LEB128. Ticks are SessionClock ticks, counted from when the
+// session started, so a replay drives its clock to exactly the same ticks.
+// A session is written only once it is complete, so a block cut short by
+// a crash can only be the last one. Readers skip it, and opening the file
+// for recording again cuts it off before appending.
+// ---------------------------------------------------------------------------
+
+const uint32_t REPLAY_MAGIC = 0x52515152; // "RQQR" read as little-endian
+const uint32_t REPLAY_VERSION = 1;
+
+// Session flags
+const uint32_t REPLAY_REAL_TIME = 1u << 0; // countdown ran on a SessionClock
+
+struct ReplayFileHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+// Why a recording stopped
+enum class ReplayEnd : uint8_t {
+    FINISHED,  // the game ended by itself: escape, shutdown or quit answer
+    QUIT,      // ended from outside with Game::quit(), e.g. a disconnect
+    ABANDONED  // the game was reset or destroyed while still running
+};
+
+struct ReplayCommand {
+    Verb verb;
+    ItemId item;
+    uint64_t tick; // since the session started
+};
+
+// One decoded session
+struct ReplaySession {
+    uint32_t worldFingerprint;
+    int difficulty;      // Difficulty as an integer
+    uint32_t flags;
+    uint64_t startTime;  // Unix seconds
+    std::string playerName;
+    std::vector<ReplayCommand> commands;
+    ReplayEnd end;
+    uint64_t endTick;
+    int score;
+    int timeRemaining;
+    uint32_t stateHash;
+};
+
+// Hash of everything in a session state
+uint32_t replayStateHash(const GameState& state);
+
+// Appends finished sessions to a replay file through a large buffer, so
+// recording costs a memcpy per session until the buffer fills. Several
+// recorders, also on different threads, may share one writer.
+class ReplayWriter {
+private:
+    std::FILE* file;
+    std::vector<char> buffer;
+    std::mutex mutex;
+
+public:
+    // Constructor
+    ReplayWriter();
+
+    // Destructor; flushes
+    ~ReplayWriter();
+
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+
+    // Open for appending, writing the file header if the file is new and
+    // cutting off a torn last block
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+    // Append one encoded session block
+    void write(const std::string& block);
+
+    // Push buffered sessions to the operating system
+    void flush();
+};
+
+// Records the session of one Game into memory, one command at a time,
+// and hands the finished block to a writer. Sessions abandoned before
+// their first command are not written.
+class ReplayRecorder {
+private:
+    ReplayWriter& writer;
+    std::string block;
+    bool active;
+    bool realTime;
+    uint64_t lastTick;
+    size_t commands;
+
+public:
+    explicit ReplayRecorder(ReplayWriter& target);
+
+    // Whether a session is being recorded
+    bool recording() const {
+        return active;
+    }
+
+    void begin(uint32_t worldFingerprint, int difficulty, const std::string& playerName,
+               bool onClock, uint64_t tick);
+    void command(const Command& command, uint64_t tick);
+    void finish(ReplayEnd end, uint64_t tick, const GameState& state);
+};
+
+// Read every complete session in a replay file. Returns false and fills
+// error if the file cannot be read at all; a torn last block is skipped.
+bool readReplays(const std::string& path, std::vector<ReplaySession>& sessions, std::string& error);
+
+// Outcome of replaying one session
+struct ReplayResult {
+    bool matched;   // world, score and state hash all agree
+    bool sameWorld;
+    int score;
+    uint32_t stateHash;
+};
+
+// Play a recorded session again on game, which must have its world loaded.
+// Real-time sessions run on clock, which is switched to manual time.
+// Output goes wherever game's output is set; use a NullSink for speed.
+ReplayResult replaySession(Game& game, SessionClock& clock, const ReplaySession& session);
+
+#endif // REPLAY_H
@@ -0,0 +1,120 @@
+// RoboQuest - A text-based adventure game in C++
+// room_index.h - Spatial index of facility rooms
+
+#ifndef ROOM_INDEX_H
+#define ROOM_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Movement directions, usable as indices into Room::neighbors
+enum Direction {
+    NORTH = 0,
+    SOUTH = 1,
+    EAST = 2,
+    WEST = 3,
+    DIRECTION_COUNT = 4
+};
+
+// A single room with its neighbors resolved to room indices
+struct Room {
+    int x;
+    int y;
+    std::string description;
+    int neighbors[DIRECTION_COUNT]; // RoomIndex::NO_ROOM when there is no exit
+};
+
+// Hash of a coordinate, for the slots of a hashed room index
+inline uint32_t roomCellHash(int x, int y) {
+    uint64_t packed = static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32 | static_cast<uint32_t>(y);
+    return static_cast<uint32_t>((packed * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+// Rooms stored in a flat array and located through a dense grid covering
+// the bounding box of all coordinates. Each grid cell holds a room index,
+// so finding a room or one of its neighbors is a plain array access.
+// Maps whose bounding box would need more than MAX_GRID_CELLS cells, or
+// more than GRID_CELLS_PER_ROOM per room, use an open-addressed hash table
+// of room indices instead, with at least twice as many slots as rooms.
+class RoomIndex {
+private:
+    std::vector<Room> rooms;
+    std::vector<int> grid; // cells, or hash slots when hashed
+    bool hashed;
+    int minX;
+    int minY;
+    int width;             // 0 when hashed
+    int height;
+
+    int locate(int64_t x, int64_t y) const;
+    size_t slotOf(int x, int y) const;
+
+public:
+    static constexpr int NO_ROOM = -1;
+    static constexpr int64_t MAX_GRID_CELLS = 1 << 20;
+    static constexpr int64_t GRID_CELLS_PER_ROOM = 64;
+
+    RoomIndex();
+
+    // Add a room; call build() once all rooms have been added
+    int addRoom(int x, int y, const std::string& description);
+
+    // Lay out the grid and precompute neighbor indices
+    void build();
+
+    // Remove all rooms
+    void clear();
+
+    // Room index at the given coordinates, or NO_ROOM
+    int find(int x, int y) const;
+
+    // Neighboring room in the given direction, or NO_ROOM
+    int neighbor(int room, Direction direction) const {
+        return rooms[room].neighbors[direction];
+    }
+
+    const Room& room(int index) const {
+        return rooms[index];
+    }
+
+    size_t size() const {
+        return rooms.size();
+    }
+
+    // Grid layout, as written into compiled world images
+    bool gridHashed() const {
+        return hashed;
+    }
+
+    // Cells of the dense grid, or slots of the hash table
+    int gridCellCount() const {
+        return static_cast<int>(grid.size());
+    }
+
+    int gridMinX() const {
+        return minX;
+    }
+
+    int gridMinY() const {
+        return minY;
+    }
+
+    int gridWidth() const {
+        return width;
+    }
+
+    int gridHeight() const {
+        return height;
+    }
+
+    int gridCell(int cell) const {
+        return grid[cell];
+    }
+};
+
+// Coordinate offsets for each direction
+int directionDX(Direction direction);
+int directionDY(Direction direction);
+
+#endif // ROOM_INDEX_H
@@ -0,0 +1,105 @@
+// RoboQuest - A text-based adventure game in C++
+// rule_table.h - A world's interaction rules, indexed by room and verb
+
+#ifndef RULE_TABLE_H
+#define RULE_TABLE_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include "command.h"
+#include "item_catalog.h"
+
+class World;
+struct WorldRuleRecord;
+
+// Flags a world's rules use are GameState flag bits: world flag bit i is
+// bit i + WORLD_FLAG_SHIFT, which makes the exit lock FLAG_EXIT_UNLOCKED
+const int WORLD_FLAG_SHIFT = 3;
+
+// One interaction rule, resolved against its world: the command that
+// triggers it, its preconditions as masks, and what it does
+struct Rule {
+    Verb verb;
+    ItemId item;             // the command's item, or ItemId::NONE
+    int order;               // position in the world, for menus
+    ItemSet required;        // items that must be carried
+    ItemSet forbidden;       // items that must not be
+    ItemSet given;
+    ItemSet taken;
+    uint32_t requiredFlags;  // GameFlag bits that must be set
+    uint32_t forbiddenFlags; // GameFlag bits that must be clear
+    uint32_t setFlags;
+    uint32_t clearedFlags;
+    int score;
+    int timeBonus;
+    uint32_t effects;        // WorldRuleEffect bits
+    int script;              // run after the effects, or WORLD_NO_SCRIPT
+    const WorldRuleRecord* record; // command, option and texts
+
+    // Whether the rule can fire for a player carrying inventory with flags set
+    bool applies(const ItemSet& inventory, uint32_t flags) const {
+        return inventory.matches(required, forbidden) &&
+               (((flags & requiredFlags) ^ requiredFlags) | (flags & forbiddenFlags)) == 0;
+    }
+};
+
+// Every rule of a world, grouped by room and, within a room, by verb, so
+// finding the rules a command may trigger is two array lookups. Checking
+// one is a few mask operations, whatever the rule does, so content added
+// to the world adds no branches to a turn. Immutable after build().
+class RuleTable {
+private:
+    static constexpr uint32_t NO_RULES = 0; // the shared table of rooms without rules
+
+    std::vector<Rule> rules;                // by room, then verb, then order
+    std::vector<uint32_t> verbStarts;       // VERB_COUNT + 1 offsets into rules per table
+    std::vector<uint32_t> roomTables;       // per room, the index of its table
+
+    std::span<const Rule> slice(uint32_t table, int first, int last) const {
+        const uint32_t* starts = &verbStarts[table * (VERB_COUNT + 1)];
+        return std::span<const Rule>(rules.data() + starts[first], starts[last] - starts[first]);
+    }
+
+public:
+    // Constructor
+    RuleTable();
+
+    RuleTable(const RuleTable&) = delete;
+    RuleTable& operator=(const RuleTable&) = delete;
+
+    // Whether commands with this verb are handled by rules
+    static bool handles(Verb verb);
+
+    // Resolve and index the rules of a loaded world, which must outlive
+    // the table; fails if a rule's command is not one rules can handle
+    bool build(const World& world, std::string& error);
+
+    // Rules a verb may trigger in a room
+    std::span<const Rule> forVerb(int room, Verb verb) const {
+        int index = static_cast<int>(verb);
+        return slice(roomTables[room], index, index + 1);
+    }
+
+    // Every rule in a room
+    std::span<const Rule> inRoom(int room) const {
+        return slice(roomTables[room], 0, VERB_COUNT);
+    }
+
+    // The first rule the command triggers in a room, or nullptr
+    const Rule* match(int room, const Command& command, const ItemSet& inventory, uint32_t flags) const {
+        for (const Rule& rule : forVerb(room, command.verb)) {
+            if (rule.item == command.item && rule.applies(inventory, flags)) {
+                return &rule;
+            }
+        }
+        return nullptr;
+    }
+
+    int size() const {
+        return static_cast<int>(rules.size());
+    }
+};
+
+#endif // RULE_TABLE_H
@@ -0,0 +1,246 @@
+// RoboQuest - A text-based adventure game in C++
+// score_store.h - Binary fixed-record score store with sorted indexes
+
+#ifndef SCORE_STORE_H
+#define SCORE_STORE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "mapped_file.h"
+
+// File layout (native byte order):
+//   <store>.rqs  ScoreStoreHeader, then ScoreRecords in append order
+//   <store>.rqs.idx  ScoreIndexHeader, then uint32 record numbers: one list
+//                    per difficulty sorted by score, and one sorted by date
+// Records are only ever appended, each carrying a checksum. The index covers
+// the first indexedRecords records, leaving out any that fail their
+// checksum; anything after that is scanned on each query until the index
+// is rebuilt. Building the index syncs the store under the store lock
+// first, so indexed records are known to be on disk and opening a store
+// only has to verify the records after them.
+const uint32_t SCORE_STORE_MAGIC = 0x53515152; // "RQQS"
+const uint32_t SCORE_INDEX_MAGIC = 0x49515152; // "RQQI"
+const uint32_t SCORE_STORE_VERSION = 2;
+const uint32_t SCORE_INDEX_VERSION = 3;
+const size_t SCORE_NAME_LENGTH = 40;
+
+enum ScoreDifficulty : uint8_t {
+    SCORE_EASY = 0,
+    SCORE_NORMAL,
+    SCORE_HARD,
+    SCORE_DIFFICULTY_COUNT
+};
+
+struct ScoreStoreHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint64_t storeId; // ties an index to the store it was built from
+    uint8_t reserved[40];
+};
+
+struct ScoreRecord {
+    char playerName[SCORE_NAME_LENGTH]; // NUL-padded, truncated if longer
+    int32_t score;
+    uint8_t difficulty; // ScoreDifficulty
+    uint8_t padding[3];
+    int64_t timestamp; // seconds since the epoch
+    uint32_t checksum; // of every byte before it
+    uint8_t reserved[4];
+};
+
+struct ScoreIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t storeId;
+    uint32_t indexedRecords;
+    uint32_t byScoreOffset[SCORE_DIFFICULTY_COUNT];
+    uint32_t byScoreCount[SCORE_DIFFICULTY_COUNT];
+    uint32_t byDateOffset;
+    uint32_t byDateCount;  // intact records among the indexed ones
+};
+
+static_assert(sizeof(ScoreStoreHeader) == 64, "score store header layout changed");
+static_assert(sizeof(ScoreRecord) == 64, "score record layout changed");
+
+// "Easy", "Normal" or "Hard"
+const char* scoreDifficultyName(ScoreDifficulty difficulty);
+
+// Parse a difficulty name; returns false if it is not one of the above
+bool parseScoreDifficulty(const std::string& name, ScoreDifficulty& difficulty);
+
+// Fill a record, truncating the name to fit
+ScoreRecord makeScoreRecord(const std::string& playerName, int score,
+                            ScoreDifficulty difficulty, int64_t timestamp);
+
+std::string scoreRecordName(const ScoreRecord& record);
+
+uint32_t scoreRecordChecksum(const ScoreRecord& record);
+
+// False for records torn by a crash or zeroed by a lost page
+bool scoreRecordValid(const ScoreRecord& record);
+
+// When appended records are forced to disk
+enum class ScoreDurability {
+    NONE,        // left to the OS
+    EVERY_WRITE, // before append() returns; concurrent appends share one sync
+    BATCHED      // by a background thread every syncInterval milliseconds
+};
+
+#ifdef _WIN32
+typedef void* ScoreFileHandle;
+#else
+typedef int ScoreFileHandle;
+#endif
+
+// Read-mostly score store. The record file and its index are memory-mapped,
+// so opening a store costs the same at any size and queries only touch the
+// pages of the records they return.
+//
+// Any number of processes may append to the same store. Each append holds
+// an advisory lock on <store>.lock for one write() call. Within a process,
+// threads that append at the same time are grouped: the first becomes the
+// leader and writes everyone's records at once while the rest wait.
+// append(), appendAll() and appendIfEmpty() may be called from any thread;
+// everything else needs external synchronization.
+//
+// Opening a store drops the damaged records after the last intact one,
+// which is where a crash during an unsynced write leaves damage. Damaged
+// records before it are kept and skipped by every query.
+class ScoreStore {
+private:
+    std::string storePath;
+    MappedFile storeFile;
+    MappedFile indexFile;
+    const ScoreStoreHeader* header;
+    const ScoreIndexHeader* index; // nullptr if missing or stale
+    uint32_t records;
+    uint64_t mappedId;   // file identity and size of the current mapping,
+    uint64_t mappedSize; // so refresh() can skip remapping when unchanged
+
+    ScoreFileHandle lockHandle;
+    ScoreFileHandle appendHandle;
+
+    // Group commit state, guarded by commitMutex
+    std::mutex commitMutex;
+    std::condition_variable commitDone;
+    std::vector<ScoreRecord> pendingRecords;
+    std::vector<int*> pendingStatus; // 0 waiting, 1 written, -1 failed
+    std::vector<ScoreRecord> writingRecords;
+    std::vector<int*> writingStatus;
+    bool leaderActive; // also held while syncing, so handles stay put
+    std::string commitError;
+
+    // Durability state, also guarded by commitMutex
+    ScoreDurability durability;
+    int syncInterval;
+    bool dirty; // written since the last sync
+    bool stopping;
+    std::condition_variable syncWake;
+    std::thread syncThread;
+    uint32_t dropped;
+
+    bool create(std::string& error);
+    bool recover(std::string& error);
+    bool syncAppended(std::unique_lock<std::mutex>& lock);
+    void syncLoop();
+    void startSyncThread();
+    void stopSyncThread();
+    bool writeBatch(const std::vector<ScoreRecord>& batch, std::string& error);
+    bool prepareAppend(uint64_t& size, std::string& error);
+    bool mapStore(std::string& error);
+    void mapIndex();
+    const uint32_t* indexList(uint32_t offset) const;
+    const ScoreRecord* recordData() const;
+
+public:
+    // Fills batch with the next records to append; false once no more follow
+    using BatchSource = std::function<bool(std::vector<ScoreRecord>& batch)>;
+
+    ScoreStore();
+    ~ScoreStore();
+
+    ScoreStore(const ScoreStore&) = delete;
+    ScoreStore& operator=(const ScoreStore&) = delete;
+
+    // Open the store at path, creating an empty one if it does not exist
+    bool open(const std::string& path, std::string& error);
+
+    void close();
+
+    bool isOpen() const {
+        return header != nullptr;
+    }
+
+    const std::string& path() const {
+        return storePath;
+    }
+
+    std::string indexPath() const {
+        return storePath + ".idx";
+    }
+
+    // Takes effect immediately if the store is open; the default is NONE
+    void setDurability(ScoreDurability mode, int intervalMilliseconds = 100);
+
+    // Force everything appended so far to disk
+    bool sync();
+
+    // Damaged records removed from the end of the file when it was opened
+    uint32_t droppedOnOpen() const {
+        return dropped;
+    }
+
+    // Append one record. Returns once it is in the file (and on disk with
+    // EVERY_WRITE); it becomes visible to queries after the next refresh().
+    bool append(const ScoreRecord& record, std::string& error);
+
+    // Append many records, written together with no others between them
+    bool appendAll(const std::vector<ScoreRecord>& batch, std::string& error);
+
+    // Append every record source yields, but only if the store file has no
+    // records yet. The check and the writes share one hold of the store
+    // lock, so when several processes do this at once exactly one appends.
+    // appended receives the number of records written.
+    bool appendIfEmpty(const BatchSource& source, uint64_t& appended, std::string& error);
+
+    // Map records appended by this or any other process since the last
+    // refresh, and follow the store if it was replaced
+    bool refresh(std::string& error);
+
+    // Sync the store, then atomically replace the index with one covering
+    // every intact record; the whole build runs under the store lock
+    bool buildIndex(std::string& error);
+
+    uint32_t recordCount() const {
+        return records;
+    }
+
+    // Records not covered by the index
+    uint32_t unindexedCount() const;
+
+    const ScoreRecord& record(uint32_t number) const {
+        return recordData()[number];
+    }
+
+    // Record numbers of the best scores, highest first; equal scores keep
+    // append order. Reads the index prefix plus the unindexed tail, where
+    // records that fail their checksum are skipped.
+    void top(ScoreDifficulty difficulty, size_t count, std::vector<uint32_t>& result) const;
+
+    // Best scores across all difficulties
+    void top(size_t count, std::vector<uint32_t>& result) const;
+
+    // Record numbers with from <= timestamp < to, oldest first; like top(),
+    // skips damaged records in the unindexed tail
+    void between(int64_t from, int64_t to, std::vector<uint32_t>& result) const;
+};
+
+#endif // SCORE_STORE_H
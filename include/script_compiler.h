@@ -0,0 +1,90 @@
+// RoboQuest - A text-based adventure game in C++
+// script_compiler.h - Compiles world script source to VM bytecode
+
+#ifndef SCRIPT_COMPILER_H
+#define SCRIPT_COMPILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One line of script source and where it came from
+struct ScriptLine {
+    std::string text;
+    int line;
+};
+
+// Names a script refers to, from the world being compiled
+struct ScriptNames {
+    std::vector<std::string> items;    // item keys by index
+    std::vector<std::string> rooms;    // room keys by index
+    std::vector<std::string> flags;    // world flag names by bit; scripts may add more
+    std::vector<std::string> counters; // counter names by slot; scripts may add more
+};
+
+// Compiles the world's script syntax (see data/facility.world) into the
+// bytecode of script_vm.h. Every script is appended to one shared code
+// array, next to the constants and strings it uses, which the world
+// compiler lays out in the image.
+class ScriptCompiler {
+public:
+    std::vector<uint32_t> code;
+    std::vector<int32_t> constants;
+    std::vector<std::string> strings;
+
+private:
+    // One token of an expression
+    struct Token {
+        enum Kind { NAME, NUMBER, SYMBOL, END } kind;
+        std::string text;
+        int32_t value;
+    };
+
+    ScriptNames* names;
+    std::vector<Token> tokens;
+    size_t position;
+    std::string error;
+    int errorLine;
+    int currentLine;
+
+    bool fail(const std::string& message);
+    bool tokenize(const std::string& text);
+    bool accept(const char* symbol);
+    bool emit(uint32_t instruction);
+    bool emitJump(int op, int reg, size_t& patch);
+    bool patchJump(size_t patch, size_t target);
+    bool loadNumber(int reg, int32_t value);
+    int flag(const std::string& name);
+    int counter(const std::string& name);
+    int lookup(const std::vector<std::string>& keys, const std::string& key) const;
+
+    // Expressions, lowest precedence first; each leaves its value in reg
+    // and may use the registers above it
+    bool condition(const std::string& text, int reg);
+    bool parseOr(int reg);
+    bool parseAnd(int reg);
+    bool parseNot(int reg);
+    bool parseComparison(int reg);
+    bool parseSum(int reg);
+    bool parseProduct(int reg);
+    bool parseUnary(int reg);
+    bool parsePrimary(int reg);
+
+public:
+    // Constructor
+    ScriptCompiler();
+
+    // Compile one script; start receives the index of its first
+    // instruction. Returns false and sets lastError() and errorLineNumber().
+    bool compile(const std::vector<ScriptLine>& lines, ScriptNames& scriptNames, uint32_t& start);
+
+    const std::string& lastError() const {
+        return error;
+    }
+
+    int errorLineNumber() const {
+        return errorLine;
+    }
+};
+
+#endif // SCRIPT_COMPILER_H
@@ -0,0 +1,120 @@
+// RoboQuest - A text-based adventure game in C++
+// script_vm.h - Bytecode and interpreter for world scripts
+
+#ifndef SCRIPT_VM_H
+#define SCRIPT_VM_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+class World;
+struct GameState;
+
+// ---------------------------------------------------------------------------
+// Script bytecode
+//
+// Every instruction is 32 bits: the opcode in the low byte, register a in
+// the next byte, then either registers b and c or one 16-bit operand x.
+// Registers hold 32-bit integers; arithmetic wraps, and dividing by zero
+// gives 0. Jumps are relative to the next instruction. Comparisons and
+// tests leave 1 or 0.
+// ---------------------------------------------------------------------------
+
+enum ScriptOp : uint8_t {
+    OP_END,       // finish the script
+    OP_LOADI,     // a = x, sign-extended
+    OP_LOADK,     // a = constants[x]
+    OP_MOVE,      // a = b
+    OP_GETVAR,    // a = counter x
+    OP_SETVAR,    // counter x = a
+    OP_GETSCORE,  // a = score
+    OP_GETTIME,   // a = seconds left
+    OP_INROOM,    // a = the player is in room x
+    OP_HAS,       // a = the player carries item x
+    OP_FLAG,      // a = world flag x is set
+    OP_ADD,       // a = b + c
+    OP_SUB,       // a = b - c
+    OP_MUL,       // a = b * c
+    OP_DIV,       // a = b / c
+    OP_MOD,       // a = b % c
+    OP_EQ,        // a = b == c
+    OP_NE,        // a = b != c
+    OP_LT,        // a = b < c
+    OP_LE,        // a = b <= c
+    OP_AND,       // a = b && c
+    OP_OR,        // a = b || c
+    OP_NOT,       // a = !b
+    OP_NEG,       // a = -b
+    OP_JUMP,      // jump by x
+    OP_JUMPIFNOT, // jump by x if a is 0
+    OP_SAY,       // write script string x as a line
+    OP_ADDSCORE,  // score += a
+    OP_ADDTIME,   // add a seconds to the countdown
+    OP_SET,       // set world flag x
+    OP_CLEAR,     // clear world flag x
+    OP_GIVE,      // add item x to the inventory
+    OP_CONSUME,   // remove item x from the inventory
+    OP_MAP,       // show the facility map
+    OP_COUNT
+};
+
+inline uint32_t scriptInstruction(ScriptOp op, int a, int b, int c) {
+    return static_cast<uint32_t>(op) | static_cast<uint32_t>(a & 0xFF) << 8 |
+           static_cast<uint32_t>(b & 0xFF) << 16 | static_cast<uint32_t>(c & 0xFF) << 24;
+}
+
+inline uint32_t scriptInstruction(ScriptOp op, int a, int x) {
+    return static_cast<uint32_t>(op) | static_cast<uint32_t>(a & 0xFF) << 8 | static_cast<uint32_t>(x & 0xFFFF) << 16;
+}
+
+// What scripts may do besides changing the session state
+class ScriptHost {
+public:
+    virtual ~ScriptHost() = default;
+
+    virtual void scriptSay(std::string_view text) = 0;
+    virtual void scriptAddTime(int seconds) = 0;
+    virtual void scriptShowMap() = 0;
+};
+
+// Runs a world's scripts against a session. Scripts only reach the
+// session's state and the host, and share a budget of instructions each
+// turn, so a runaway loop ends the script instead of the game. Images are
+// checked once by verify(); run() then needs no bounds checks.
+class ScriptVM {
+public:
+    static constexpr int REGISTER_COUNT = 32;
+    static constexpr int TURN_BUDGET = 10000; // instructions per turn, all scripts together
+
+private:
+    int budget;
+
+public:
+    // Constructor
+    ScriptVM();
+
+    // Check every script and script reference in a world: operands in
+    // range, jumps inside their script, every script ending in OP_END
+    static bool verify(const World& world, std::string& error);
+
+    // Whether any script of a verified world reads the score or the time
+    // left; if so, having more of either can change what happens
+    static bool readsTimeOrScore(const World& world);
+
+    // Refill the budget; called at the start of every turn
+    void newTurn() {
+        budget = TURN_BUDGET;
+    }
+
+    // Instructions left this turn
+    int budgetLeft() const {
+        return budget;
+    }
+
+    // Run a script of a verified world; false if it ran out of budget,
+    // in which case what it did so far stands
+    bool run(const World& world, int script, GameState& state, ScriptHost& host);
+};
+
+#endif // SCRIPT_VM_H
@@ -0,0 +1,73 @@
+// RoboQuest - A text-based adventure game in C++
+// session_clock.h - Wall-clock countdowns for game sessions
+
+#ifndef SESSION_CLOCK_H
+#define SESSION_CLOCK_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "timer_wheel.h"
+
+class Game;
+
+// Runs the shutdown countdown of any number of sessions in real time on
+// one timer wheel with 10 ms ticks. Whoever owns the clock calls advance()
+// regularly from the thread that drives the sessions; expired sessions are
+// ended from inside advance(). Not thread-safe.
+class SessionClock {
+private:
+    TimerWheel wheel;
+    std::chrono::steady_clock::time_point origin;
+    std::vector<uint64_t> expired;
+    bool manual;         // time is set with setTick() instead
+    uint64_t manualTick;
+
+    uint64_t currentTick() const;
+
+public:
+    static constexpr int TICK_MS = 10;
+
+    SessionClock();
+
+    SessionClock(const SessionClock&) = delete;
+    SessionClock& operator=(const SessionClock&) = delete;
+
+    // Start a countdown that ends game after the given number of seconds
+    TimerHandle start(Game& game, int seconds);
+
+    // The same, counting from the given tick
+    TimerHandle start(Game& game, int seconds, uint64_t tick);
+
+    // Drop a countdown without ending its game
+    void stop(TimerHandle countdown);
+
+    // Add (or with a negative value remove) time from a running countdown
+    bool extend(TimerHandle countdown, int seconds);
+
+    // Milliseconds left; 0 once the countdown has run out or was stopped
+    int64_t remainingMilliseconds(TimerHandle countdown) const;
+
+    // The same as of a given tick, so one turn can see a single time
+    int64_t remainingMilliseconds(TimerHandle countdown, uint64_t tick) const;
+
+    // Current time in ticks of TICK_MS
+    uint64_t tick() const {
+        return currentTick();
+    }
+
+    // Stop following the wall clock and set the time by hand from now on,
+    // e.g. to replay a recorded session; time never goes back
+    void setTick(uint64_t tick);
+
+    // End every session whose time has run out; returns how many ended
+    size_t advance();
+
+    // Countdowns still running
+    size_t size() const {
+        return wheel.size();
+    }
+};
+
+#endif // SESSION_CLOCK_H
@@ -0,0 +1,176 @@
+// RoboQuest - A text-based adventure game in C++
+// session_task.h - Coroutine types for sessions that wait on input lines
+
+#ifndef SESSION_TASK_H
+#define SESSION_TASK_H
+
+#include <coroutine>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Lines of input for a session coroutine. The driver delivers each line,
+// which resumes the coroutine waiting for it right away; close() resumes
+// it with nothing so it can finish.
+class InputChannel {
+private:
+    std::coroutine_handle<> waiter;
+    std::string current;
+    bool closed;
+
+    void resumeWaiter() {
+        std::coroutine_handle<> handle = waiter;
+        waiter = nullptr;
+        handle.resume();
+    }
+
+public:
+    // Awaiting the next line yields false once input is closed
+    struct Next {
+        InputChannel& channel;
+
+        bool await_ready() const noexcept {
+            return channel.closed;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            channel.waiter = handle;
+        }
+
+        bool await_resume() const noexcept {
+            return !channel.closed;
+        }
+    };
+
+    // Constructor
+    InputChannel() : closed(false) {
+    }
+
+    InputChannel(const InputChannel&) = delete;
+    InputChannel& operator=(const InputChannel&) = delete;
+
+    // co_await next() suspends until a line arrives
+    Next next() {
+        return Next{*this};
+    }
+
+    // The line the last next() returned
+    const std::string& line() const {
+        return current;
+    }
+
+    // Whether a coroutine is suspended waiting for a line
+    bool waiting() const {
+        return static_cast<bool>(waiter);
+    }
+
+    // Hand a line to the waiting coroutine and run it until it waits
+    // again or finishes; lines nobody waits for are dropped
+    void deliver(std::string_view text) {
+        if (waiter) {
+            current.assign(text.data(), text.size());
+            resumeWaiter();
+        }
+    }
+
+    // No more input; a waiting coroutine resumes and sees false
+    void close() {
+        closed = true;
+        if (waiter) {
+            resumeWaiter();
+        }
+    }
+};
+
+// A session coroutine. It starts running as soon as it is called and
+// suspends only to wait for input, so a session between lines costs just
+// its frame. Another session coroutine can co_await it; the awaiting one
+// resumes when it finishes. Exceptions propagate to whoever resumed it.
+class SessionTask {
+public:
+    struct promise_type {
+        std::coroutine_handle<> continuation;
+
+        struct FinalAwaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                std::coroutine_handle<> next = handle.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {
+            }
+        };
+
+        SessionTask get_return_object() {
+            return SessionTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_never initial_suspend() const noexcept {
+            return {};
+        }
+
+        FinalAwaiter final_suspend() const noexcept {
+            return {};
+        }
+
+        void return_void() {
+        }
+
+        void unhandled_exception() {
+            throw;
+        }
+    };
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit SessionTask(std::coroutine_handle<promise_type> coroutine) : handle(coroutine) {
+    }
+
+public:
+    // Constructor
+    SessionTask() : handle(nullptr) {
+    }
+
+    SessionTask(SessionTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {
+    }
+
+    SessionTask& operator=(SessionTask&& other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+
+    SessionTask(const SessionTask&) = delete;
+    SessionTask& operator=(const SessionTask&) = delete;
+
+    // Destructor; a session still waiting for input is dropped
+    ~SessionTask() {
+        if (handle) handle.destroy();
+    }
+
+    // Whether the session has run to its end (or was never started)
+    bool done() const {
+        return !handle || handle.done();
+    }
+
+    // co_await a session from another session
+    bool await_ready() const noexcept {
+        return done();
+    }
+
+    void await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+    }
+
+    void await_resume() const noexcept {
+    }
+};
+
+#endif // SESSION_TASK_H
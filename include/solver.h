@@ -0,0 +1,52 @@
+// RoboQuest - A text-based adventure game in C++
+// solver.h - Exhaustive route search over the game state space
+
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "game.h"
+#include "thread_pool.h"
+
+struct SolverOptions {
+    Difficulty difficulty = Difficulty::NORMAL;
+    int maxTurns = 60;          // search horizon
+    size_t maxStates = 5000000; // stop once this many states were kept
+};
+
+struct SolverResult {
+    bool winnable = false;
+    std::vector<std::string> shortestWin; // fewest commands to escape
+    int shortestWinScore = 0;
+    std::vector<std::string> bestWin;     // highest score at escape
+    int bestWinScore = 0;
+    int bestScore = 0;                    // highest score in any state
+    std::vector<std::string> scoreLoop;   // commands that repeat for free points
+    size_t statesKept = 0;
+    size_t statesExpanded = 0;
+    int layers = 0;
+    bool truncated = false;               // horizon or state limit reached
+    bool pruned = true;                   // false if scripts read time or score
+};
+
+// Breadth-first search over GameState snapshots. Transitions are produced
+// by the real engine (restore, step, snapshot), so every rule the game
+// implements is automatically part of the search. States reaching the same
+// room, items and flags are kept only while no other state has at least as
+// much time and score, which keeps the frontier small. Worlds whose scripts
+// read the time or score are searched without that pruning, since there
+// more of either can be worse.
+class RouteSolver {
+private:
+    ThreadPool& pool;
+
+public:
+    explicit RouteSolver(ThreadPool& threadPool) : pool(threadPool) {}
+
+    // Returns false if the world could not be loaded
+    bool solve(const SolverOptions& options, SolverResult& result);
+};
+
+#endif // SOLVER_H
@@ -0,0 +1,56 @@
+// RoboQuest - A text-based adventure game in C++
+// thread_pool.h - Fixed pool of worker threads for parallel loops
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs index ranges across a fixed set of threads. Work is handed out in
+// chunks from a shared counter, so fast workers simply take more chunks.
+class ThreadPool {
+public:
+    // Called with [begin, end) and the index of the worker running it
+    using RangeTask = std::function<void(size_t begin, size_t end, unsigned worker)>;
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    // Current parallelFor job
+    const RangeTask* task;
+    size_t jobSize;
+    size_t chunkSize;
+    size_t nextIndex;
+    unsigned activeWorkers;
+    unsigned long long generation;
+    bool stopping;
+
+    void workerLoop(unsigned worker);
+    void runChunks(unsigned worker);
+
+public:
+    // threadCount 0 means one thread per hardware core
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const {
+        return static_cast<unsigned>(threads.size()) + 1;
+    }
+
+    // Run task over [0, count) in chunks and wait for completion. The calling
+    // thread takes part as worker 0.
+    void parallelFor(size_t count, size_t chunk, const RangeTask& rangeTask);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,82 @@
+// RoboQuest - A text-based adventure game in C++
+// timer_wheel.h - Hierarchical timing wheel for large numbers of timers
+
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Identifies a scheduled timer; stale handles are rejected
+typedef uint64_t TimerHandle;
+const TimerHandle NO_TIMER = 0;
+
+// Timers with deadlines in abstract ticks, kept in four levels of 256
+// slots each. Level 0 holds timers due within 256 ticks, level 1 within
+// 65536, and so on; when a lower level wraps, the next slot of the level
+// above is cascaded down. Scheduling and cancelling are O(1), and
+// advancing costs one slot per tick plus the timers it touches.
+//
+// Extending a timer only moves its deadline. When its slot comes round
+// and the deadline is still ahead it is filed again, so repeated
+// extensions never search or relink anything.
+class TimerWheel {
+private:
+    static constexpr int LEVELS = 4;
+    static constexpr int SLOT_BITS = 8;
+    static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    struct Node {
+        uint64_t deadline;
+        uint64_t userData;
+        uint32_t next;
+        uint32_t prev;
+        uint32_t generation;
+        uint32_t bucket; // NIL while free
+    };
+
+    std::vector<Node> nodes;
+    uint32_t freeList;
+    uint32_t buckets[LEVELS * SLOTS]; // list heads
+    uint64_t currentTick;
+    size_t active;
+
+    void link(uint32_t index);
+    void linkInto(uint32_t index, uint32_t bucket);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    bool lookup(TimerHandle handle, uint32_t& index) const;
+    void cascade(int level);
+
+public:
+    explicit TimerWheel(uint64_t startTick = 0);
+
+    // Fire userData once the wheel reaches deadline (a deadline already
+    // passed fires on the next advance)
+    TimerHandle schedule(uint64_t deadline, uint64_t userData);
+
+    // Returns false if the timer already fired or was cancelled
+    bool cancel(TimerHandle handle);
+
+    // Move a pending timer's deadline by ticks (negative to shorten)
+    bool extend(TimerHandle handle, int64_t ticks);
+
+    // Deadline of a pending timer; false if it is no longer pending
+    bool deadline(TimerHandle handle, uint64_t& tick) const;
+
+    // Move the wheel forward to tick and append the userData of every
+    // timer that fell due; returns how many fired
+    size_t advance(uint64_t tick, std::vector<uint64_t>& expired);
+
+    uint64_t now() const {
+        return currentTick;
+    }
+
+    size_t size() const {
+        return active;
+    }
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,95 @@
+// RoboQuest - A text-based adventure game in C++
+// turn_scheduler.h - Work-stealing scheduler for session turns
+
+#ifndef TURN_SCHEDULER_H
+#define TURN_SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Totals since the scheduler started
+struct SchedulerStats {
+    uint64_t turns;      // turns run
+    uint64_t steals;     // sessions taken from another worker's queue
+    uint64_t homeRuns;   // times a session ran on the worker that ran it last
+    uint64_t dispatches; // times a session was picked up to run
+};
+
+// Runs the turns of many sessions on a fixed set of threads. Each
+// session queues its own turns and runs them strictly one at a time, in
+// order; a session with turns waiting sits in the ready queue of one
+// worker. Workers take sessions from their own queue first and steal
+// from the others only when it runs dry, so there is no shared queue to
+// contend on.
+//
+// A session goes back to the worker that last ran it, so its game state
+// tends to still be in that core's cache. A turn may submit further turns,
+// to its own session or any other.
+class TurnScheduler {
+public:
+    using Turn = std::function<void()>;
+
+    // Turns a worker runs for one session before moving to the next
+    static constexpr unsigned TURNS_PER_DISPATCH = 8;
+
+    class Session;
+
+private:
+    struct Worker;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::mutex sessionsMutex;
+    std::atomic<unsigned> nextHome;
+
+    // Sessions sitting in ready queues, and workers asleep waiting for one
+    std::atomic<size_t> queued;
+    std::atomic<unsigned> sleeping;
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    bool stopping;
+
+    // Sessions that are queued or running; wait() returns at zero
+    std::atomic<size_t> outstanding;
+    std::mutex drainMutex;
+    std::condition_variable drained;
+
+    void makeReady(Session& session, unsigned worker);
+    Session* takeOwn(Worker& worker);
+    Session* steal(unsigned thief);
+    void dispatch(Worker& worker, Session& session);
+    void workerLoop(unsigned index);
+
+public:
+    // threadCount 0 means one thread per hardware core
+    explicit TurnScheduler(unsigned threadCount = 0);
+    ~TurnScheduler();
+
+    TurnScheduler(const TurnScheduler&) = delete;
+    TurnScheduler& operator=(const TurnScheduler&) = delete;
+
+    unsigned size() const {
+        return static_cast<unsigned>(workers.size());
+    }
+
+    // A new session; it lives as long as the scheduler. Sessions are
+    // spread over the workers round robin.
+    Session& addSession();
+
+    // Queue a turn for a session; safe from any thread, including a turn
+    void submit(Session& session, Turn turn);
+
+    // Block until every submitted turn has run
+    void wait();
+
+    SchedulerStats stats() const;
+};
+
+#endif // TURN_SCHEDULER_H
@@ -0,0 +1,285 @@
+// RoboQuest - A text-based adventure game in C++
+// world.h - Binary world image format and read-only World view
+
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "mapped_file.h"
+#include "room_index.h"
+
+// ---------------------------------------------------------------------------
+// World image layout
+//
+// A world image is a single blob produced by the world compiler. Every
+// reference inside it is an offset from the start of the image, so the blob
+// can be mapped at any address and used in place without fixups. All fields
+// are fixed-width little-endian.
+//
+//   WorldImageHeader
+//   WorldRoomRecord[roomCount]
+//   int32_t grid[gridWidth * gridHeight]   (room index or NO_ROOM), or
+//   int32_t grid[gridHashSlots]            (open-addressed by roomCellHash
+//                                           when gridHashSlots is nonzero)
+//   WorldItemRecord[itemCount]
+//   WorldRuleRecord[ruleCount]
+//   WorldScriptRecord[scriptCount]
+//   uint32_t scriptCode[scriptCodeSize]    (bytecode, see script_vm.h)
+//   int32_t scriptConstants[scriptConstantCount]
+//   WorldString scriptStrings[scriptStringCount]
+//   int32_t itemSlots[itemHashSlots]      (perfect hash of item keys)
+//   string pool                            (NUL-terminated strings)
+// ---------------------------------------------------------------------------
+
+const uint32_t WORLD_IMAGE_MAGIC = 0x57515152; // "RQQW" read as little-endian
+const uint32_t WORLD_IMAGE_VERSION = 6;
+
+// Reference to a string in the string pool
+struct WorldString {
+    uint32_t offset; // from the start of the image
+    uint32_t length; // excluding the terminating NUL
+};
+
+// 64-bit words in an item mask, one bit per item index (MAX_ITEMS bits)
+const int WORLD_ITEM_WORDS = 4;
+
+// Most items a world may define, so every item has a bit in the masks
+const int WORLD_ITEM_LIMIT = WORLD_ITEM_WORDS * 64;
+
+// World flags, which rules test, set and clear. Bit 0 is the exit lock;
+// the others are named in the world source, in order of first use.
+const uint32_t WORLD_FLAG_EXIT_UNLOCKED = 1u << 0;
+const int WORLD_FLAG_COUNT = 29;
+
+// Counters scripts keep for each session, named in the world source
+const int WORLD_COUNTER_COUNT = 8;
+
+// Script index meaning "no script"
+const int32_t WORLD_NO_SCRIPT = -1;
+
+// Effects applied by a rule besides its flags, items, time and score
+enum WorldRuleEffect : uint32_t {
+    RULE_SHOW_MAP = 1u << 0
+};
+
+struct WorldImageHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t imageSize;
+    uint32_t fingerprint;   // nameHash of the image with this field zeroed
+    uint32_t roomCount;
+    uint32_t roomOffset;
+    int32_t gridMinX;
+    int32_t gridMinY;
+    uint32_t gridWidth;
+    uint32_t gridHeight;
+    uint32_t gridHashSlots; // if not 0, the grid is a RoomIndex hash table
+    uint32_t gridOffset;
+    uint32_t itemCount;
+    uint32_t itemOffset;
+    uint32_t ruleCount;
+    uint32_t ruleOffset;
+    uint32_t scriptCount;
+    uint32_t scriptOffset;
+    uint32_t scriptCodeSize;  // in instructions
+    uint32_t scriptCodeOffset;
+    uint32_t scriptConstantCount;
+    uint32_t scriptConstantOffset;
+    uint32_t scriptStringCount;
+    uint32_t scriptStringOffset;
+    int32_t turnScript;       // run after every turn, or WORLD_NO_SCRIPT
+    uint32_t itemHashSeed;  // nameHash seed giving every item key its own slot
+    uint32_t itemHashSlots; // power of two
+    uint32_t itemHashOffset;
+    int32_t startRoom;
+    int32_t goalRoom;
+    WorldString mapText;
+};
+
+struct WorldRoomRecord {
+    int32_t x;
+    int32_t y;
+    int32_t neighbors[DIRECTION_COUNT];
+    WorldString key;
+    WorldString name;
+    WorldString description;
+    int32_t enterScript;    // run when the player walks in, or WORLD_NO_SCRIPT
+};
+
+struct WorldItemRecord {
+    WorldString key;
+    WorldString name;
+    WorldString info;       // inventory description
+    int32_t room;           // room the item starts in
+};
+
+// One interaction: a command that does something in a room while the
+// player carries, or lacks, certain items and flags. Taking an item is a
+// rule too, compiled from the item's own fields.
+struct WorldRuleRecord {
+    uint64_t requiredItems[WORLD_ITEM_WORDS];  // items that must be carried
+    uint64_t forbiddenItems[WORLD_ITEM_WORDS]; // items that must not be
+    uint64_t givenItems[WORLD_ITEM_WORDS];     // added to the inventory
+    uint64_t takenItems[WORLD_ITEM_WORDS];     // removed from it
+    int32_t room;
+    WorldString command;    // what the player types, e.g. "use power_cell"
+    WorldString option;     // menu label
+    WorldString text;       // message, lines separated by '\n'
+    WorldString lookText;   // shown by look while the rule applies
+    uint32_t requiredFlags; // world flags that must be set
+    uint32_t forbiddenFlags;
+    uint32_t setFlags;
+    uint32_t clearedFlags;
+    int32_t score;
+    int32_t timeBonus;      // seconds added to the countdown
+    uint32_t effects;       // WorldRuleEffect bits
+    int32_t script;         // run after the effects above, or WORLD_NO_SCRIPT
+};
+
+// A compiled script: a range of the shared bytecode
+struct WorldScriptRecord {
+    WorldString name;
+    uint32_t codeStart;     // index of the first instruction
+    uint32_t codeLength;    // in instructions; the last one ends the script
+};
+
+// Read-only view of a world image, either memory-mapped from a compiled
+// file or owned in memory after compiling a source file on the fly.
+class World {
+private:
+    MappedFile mapping;
+    std::vector<char> ownedImage;
+    const char* base;
+    const WorldImageHeader* header;
+    const WorldRoomRecord* rooms;
+    const int32_t* grid;
+    const WorldItemRecord* items;
+    const WorldRuleRecord* rules;
+    const WorldScriptRecord* scripts;
+    const uint32_t* code;
+    const int32_t* constants;
+    const WorldString* scriptStrings;
+    const int32_t* itemSlots;
+
+    bool attach(const char* data, size_t size, std::string& error);
+
+public:
+    World();
+
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+
+    // Map a compiled world image
+    bool loadImage(const std::string& path, std::string& error);
+
+    // Compile a world source file into memory
+    bool loadSource(const std::string& path, std::string& error);
+
+    // Take ownership of an image already in memory
+    bool loadBuffer(std::vector<char> image, std::string& error);
+
+    // Hash of the whole image, computed by the compiler; equal images give
+    // equal fingerprints
+    uint32_t fingerprint() const {
+        return header ? header->fingerprint : 0;
+    }
+
+    bool isLoaded() const {
+        return header != nullptr;
+    }
+
+    std::string_view text(const WorldString& ref) const {
+        return std::string_view(base + ref.offset, ref.length);
+    }
+
+    // Rooms
+    int roomCount() const {
+        return static_cast<int>(header->roomCount);
+    }
+
+    const WorldRoomRecord& room(int index) const {
+        return rooms[index];
+    }
+
+    int neighbor(int room, Direction direction) const {
+        return rooms[room].neighbors[direction];
+    }
+
+    int startRoom() const {
+        return header->startRoom;
+    }
+
+    int goalRoom() const {
+        return header->goalRoom;
+    }
+
+    // Room at the given coordinates, or RoomIndex::NO_ROOM
+    int findRoom(int x, int y) const;
+
+    // Items
+    int itemCount() const {
+        return static_cast<int>(header->itemCount);
+    }
+
+    const WorldItemRecord& item(int index) const {
+        return items[index];
+    }
+
+    // Item index by key, or -1; a single probe of the item hash table
+    int findItem(std::string_view key) const;
+
+    // Interactions, in source order
+    int ruleCount() const {
+        return static_cast<int>(header->ruleCount);
+    }
+
+    const WorldRuleRecord& rule(int index) const {
+        return rules[index];
+    }
+
+    // Scripts and the sections they share
+    int scriptCount() const {
+        return static_cast<int>(header->scriptCount);
+    }
+
+    const WorldScriptRecord& script(int index) const {
+        return scripts[index];
+    }
+
+    int scriptCodeSize() const {
+        return static_cast<int>(header->scriptCodeSize);
+    }
+
+    const uint32_t* scriptCode() const {
+        return code;
+    }
+
+    int scriptConstantCount() const {
+        return static_cast<int>(header->scriptConstantCount);
+    }
+
+    const int32_t* scriptConstants() const {
+        return constants;
+    }
+
+    int scriptStringCount() const {
+        return static_cast<int>(header->scriptStringCount);
+    }
+
+    std::string_view scriptString(int index) const {
+        return text(scriptStrings[index]);
+    }
+
+    int turnScript() const {
+        return header->turnScript;
+    }
+
+    std::string_view mapText() const {
+        return text(header->mapText);
+    }
+};
+
+#endif // WORLD_H
@@ -0,0 +1,107 @@
+// RoboQuest - A text-based adventure game in C++
+// world_compiler.h - Compiles world source files into binary world images
+
+#ifndef WORLD_COMPILER_H
+#define WORLD_COMPILER_H
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <vector>
+#include "script_compiler.h"
+
+// Parses the text world format (see data/facility.world) and lays it out
+// as a relocatable image in the format described in world.h.
+class WorldCompiler {
+private:
+    struct RoomDef {
+        std::string key;
+        int x;
+        int y;
+        std::string name;
+        std::string description;
+        int exitMask; // bit per Direction, -1 for every adjacent room
+        int line;
+    };
+
+    struct ItemDef {
+        std::string key;
+        std::string name;
+        std::string info;
+        std::string room;
+        std::string lookText;
+        std::string takeText;
+        std::string takeOption;
+        int score;
+        int line;
+    };
+
+    // A use or action block; take rules come from the items themselves
+    struct RuleDef {
+        std::string room;
+        std::string command;
+        std::string option;
+        std::string text;
+        std::string lookText;
+        std::vector<std::string> requiredItems;
+        std::vector<std::string> forbiddenItems;
+        std::vector<std::string> givenItems;
+        std::vector<std::string> takenItems;
+        uint32_t requiredFlags; // world flag bits
+        uint32_t forbiddenFlags;
+        uint32_t setFlags;
+        uint32_t clearedFlags;
+        int score;
+        int timeBonus;
+        unsigned effects;
+        std::string script; // run after the effects, if not empty
+        int line;
+    };
+
+    struct ScriptDef {
+        std::string name;
+        std::vector<ScriptLine> lines;
+        int line;
+    };
+
+    // An "on enter" or "on turn" event
+    struct EventDef {
+        std::string room; // empty for every turn
+        std::string script;
+        int line;
+    };
+
+    std::string sourceName;
+    std::string startRoom;
+    std::string goalRoom;
+    std::string mapText;
+    std::vector<RoomDef> rooms;
+    std::vector<ItemDef> items;
+    std::vector<RuleDef> rules;
+    std::vector<ScriptDef> scripts;
+    std::vector<EventDef> events;
+    std::vector<std::string> flags; // world flag names by bit
+    std::string error;
+
+    bool parse(std::istream& source);
+    bool fail(int line, const std::string& message);
+    bool emit(std::vector<char>& image);
+    int roomIndex(const std::string& key) const;
+    int itemIndex(const std::string& key) const;
+    int scriptIndex(const std::string& name) const;
+    bool addFlags(int line, const std::string& names, uint32_t& mask);
+    bool resolveItems(const RuleDef& rule, const std::vector<std::string>& keys, uint64_t* mask);
+
+public:
+    // Compile source text into an image; returns false and sets error()
+    bool compile(std::istream& source, const std::string& name, std::vector<char>& image);
+
+    // Compile a world source file into an image
+    bool compileFile(const std::string& path, std::vector<char>& image);
+
+    const std::string& lastError() const {
+        return error;
+    }
+};
+
+#endif // WORLD_COMPILER_H
@@ -0,0 +1,66 @@
+// RoboQuest - A text-based adventure game in C++
+// world_publisher.h - Publishes new versions of a world to running sessions
+
+#ifndef WORLD_PUBLISHER_H
+#define WORLD_PUBLISHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "game_world.h"
+
+// Hands out the current version of a world, read-copy-update style. A
+// session takes a reference to the current version when it starts and
+// plays it to the end; publishing a new version is a single atomic
+// pointer swap, so new sessions see it at once while running ones are
+// untouched, and an old version is freed when the last session holding
+// it ends. Turns never come here, so the hot path takes no lock.
+//
+// Versions are read into memory rather than mapped, so replacing or even
+// truncating the files cannot disturb a version still in play.
+class WorldPublisher {
+private:
+    std::string imagePath;
+    std::string sourcePath;
+    std::atomic<std::shared_ptr<const GameWorld>> published;
+    std::atomic<uint64_t> publishedVersion;
+
+public:
+    // Constructor
+    WorldPublisher(const std::string& image, const std::string& source);
+
+    WorldPublisher(const WorldPublisher&) = delete;
+    WorldPublisher& operator=(const WorldPublisher&) = delete;
+
+    // Read the compiled image, or compile the source if there is no usable
+    // image, and publish it unless it equals the current version. Returns
+    // false and fills error, keeping the current version, if neither loads.
+    bool reloadImage(std::string& error);
+
+    // The same from the source file, for edits not yet compiled
+    bool reloadSource(std::string& error);
+
+    // Make a world the current version
+    void publish(std::shared_ptr<const GameWorld> world);
+
+    // The current version; nullptr before anything was published
+    std::shared_ptr<const GameWorld> current() const {
+        return published.load(std::memory_order_acquire);
+    }
+
+    // Counts publications, starting at 1 for the first
+    uint64_t version() const {
+        return publishedVersion.load(std::memory_order_acquire);
+    }
+
+    const std::string& image() const {
+        return imagePath;
+    }
+
+    const std::string& source() const {
+        return sourcePath;
+    }
+};
+
+#endif // WORLD_PUBLISHER_H
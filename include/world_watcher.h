@@ -0,0 +1,53 @@
+// RoboQuest - A text-based adventure game in C++
+// world_watcher.h - Notices edits to world files with inotify (Linux)
+
+#ifndef WORLD_WATCHER_H
+#define WORLD_WATCHER_H
+
+#ifdef __linux__
+
+#include <string>
+
+// What changed since the last call to readChanges()
+struct WorldChanges {
+    bool image = false;
+    bool source = false;
+};
+
+// Watches the directories holding a world's image and source for either
+// file being written or replaced, as RoboQuest_worldc and most editors do
+// by renaming a new file over the old one. The descriptor is non-blocking
+// and can be polled together with sockets.
+class WorldWatcher {
+private:
+    int fd;
+    int imageWatch;
+    int sourceWatch;
+    std::string imageName;
+    std::string sourceName;
+
+public:
+    // Constructor
+    WorldWatcher();
+
+    // Destructor
+    ~WorldWatcher();
+
+    WorldWatcher(const WorldWatcher&) = delete;
+    WorldWatcher& operator=(const WorldWatcher&) = delete;
+
+    // Start watching; returns false and fills error on failure
+    bool start(const std::string& imagePath, const std::string& sourcePath, std::string& error);
+
+    // Readable when there are changes to collect
+    int descriptor() const {
+        return fd;
+    }
+
+    // Drain pending events
+    WorldChanges readChanges();
+};
+
+#endif // __linux__
+
+#endif // WORLD_WATCHER_H
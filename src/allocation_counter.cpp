@@ -0,0 +1,35 @@
+// RoboQuest - A text-based adventure game in C++
+// allocation_counter.cpp - Per-thread heap allocation counting
+
+#include "../include/metrics.h"
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+// Replaces the global allocation operators. Part of the core library with
+// ROBOQUEST_METRICS, and otherwise linked only into the benchmarks, so
+// other builds keep the standard operators.
+namespace {
+thread_local uint64_t allocationCount = 0;
+}
+
+// Count every allocation of the thread making it
+void* operator new(size_t size) {
+    allocationCount++;
+    if (void* block = std::malloc(size == 0 ? 1 : size)) {
+        return block;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+    std::free(block);
+}
+
+uint64_t threadAllocationCount() {
+    return allocationCount;
+}
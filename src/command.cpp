@@ -0,0 +1,131 @@
+// command.cpp - Parsing of player commands
+
+#include "../include/command.h"
+#include "../include/name_hash.h"
+#include "../include/world.h"
+
+namespace {
+
+// One recognized first word. Some verbs only match with a fixed object
+// ("fix build"); take and use expect an item name instead.
+struct VerbEntry {
+    std::string_view word;
+    Verb verb;
+    std::string_view object;
+    bool takesItem;
+};
+
+constexpr VerbEntry VERBS[] = {
+    {"north", Verb::NORTH, "", false},
+    {"south", Verb::SOUTH, "", false},
+    {"east", Verb::EAST, "", false},
+    {"west", Verb::WEST, "", false},
+    {"look", Verb::LOOK, "", false},
+    {"inventory", Verb::INVENTORY, "", false},
+    {"take", Verb::TAKE, "", true},
+    {"use", Verb::USE, "", true},
+    {"help", Verb::HELP, "", false},
+    {"quit", Verb::QUIT, "", false},
+    {"examine", Verb::EXAMINE_PIPELINE, "pipeline", false},
+    {"check", Verb::CHECK_VERSION, "version", false},
+    {"fix", Verb::FIX_BUILD, "build", false},
+};
+
+constexpr size_t VERB_ENTRY_COUNT = sizeof(VERBS) / sizeof(VERBS[0]);
+constexpr uint32_t VERB_SLOTS = 64; // power of two, larger than VERB_ENTRY_COUNT
+
+struct VerbTable {
+    uint32_t seed;
+    int8_t slots[VERB_SLOTS]; // index into VERBS, or -1
+};
+
+// Search for a seed that gives every verb its own slot
+constexpr VerbTable buildVerbTable() {
+    for (uint32_t seed = 1; seed < 10000; seed++) {
+        VerbTable table{seed, {}};
+        for (uint32_t slot = 0; slot < VERB_SLOTS; slot++) {
+            table.slots[slot] = -1;
+        }
+        bool collision = false;
+        for (size_t i = 0; i < VERB_ENTRY_COUNT && !collision; i++) {
+            uint32_t slot = nameHash(VERBS[i].word, seed) & (VERB_SLOTS - 1);
+            collision = table.slots[slot] >= 0;
+            table.slots[slot] = static_cast<int8_t>(i);
+        }
+        if (!collision) {
+            return table;
+        }
+    }
+    return VerbTable{0, {}};
+}
+
+constexpr VerbTable VERB_TABLE = buildVerbTable();
+static_assert(VERB_TABLE.seed != 0, "no perfect hash seed found for the verb table");
+
+// Split off the next space-separated word
+std::string_view nextWord(std::string_view& text) {
+    size_t begin = text.find_first_not_of(' ');
+    if (begin == std::string_view::npos) {
+        text = std::string_view();
+        return text;
+    }
+    text.remove_prefix(begin);
+    size_t end = text.find(' ');
+    std::string_view word = text.substr(0, end);
+    text.remove_prefix(end == std::string_view::npos ? text.size() : end);
+    return word;
+}
+
+// Answers to a yes/no question go by their first letter, so "Yes",
+// "YES" and "yeah" all confirm
+Verb answerVerb(std::string_view word) {
+    if (word.empty()) {
+        return Verb::UNKNOWN;
+    }
+    switch (word[0]) {
+        case 'y':
+        case 'Y':
+            return Verb::YES;
+        case 'n':
+        case 'N':
+            return Verb::NO;
+        default:
+            return Verb::UNKNOWN;
+    }
+}
+
+} // namespace
+
+// Parse a command line into a verb and its item
+Command parseCommand(std::string_view input, const World& world) {
+    Command command;
+    command.verb = Verb::UNKNOWN;
+    command.item = ItemId::NONE;
+
+    std::string_view rest = input;
+    std::string_view word = nextWord(rest);
+    int slot = VERB_TABLE.slots[nameHash(word, VERB_TABLE.seed) & (VERB_SLOTS - 1)];
+    if (slot < 0 || VERBS[slot].word != word) {
+        command.verb = answerVerb(word);
+        return command;
+    }
+
+    std::string_view object = nextWord(rest);
+    if (!nextWord(rest).empty()) {
+        return command; // no command has more than two words
+    }
+
+    const VerbEntry& entry = VERBS[slot];
+    if (entry.takesItem) {
+        if (object.empty()) {
+            return command;
+        }
+        command.argument = object;
+        command.item = static_cast<ItemId>(world.findItem(object));
+    } else if (object != entry.object) {
+        return command;
+    }
+
+    command.verb = entry.verb;
+    return command;
+}
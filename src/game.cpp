@@ -1,79 +1,126 @@
 // game.cpp - Implementation of the Game class
 
 #include "../include/game.h"
+#include "../include/metrics.h"
 #include <iostream>
-#include <sstream>
 #include <iomanip>
 #include <algorithm>
 #include <chrono>
 #include <thread>
 #include <limits>
+#include <charconv>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Read a menu number like an int from a stream: leading blanks, then
+// digits; anything else is 0
+int menuChoice(std::string_view line) {
+    size_t start = line.find_first_not_of(" \t");
+    int choice = 0;
+    if (start != std::string_view::npos) {
+        std::from_chars(line.data() + start, line.data() + line.size(), choice);
+    }
+    return choice;
+}
+
+} // namespace
 
 // Constructor
 Game::Game() : 
-    running(false),
     difficulty(Difficulty::NORMAL),
     playerName("Player"),
-    score(0),
-    timeRemaining(480), // 8 minutes by default
-    playerX(0),
-    playerY(0),
-    scoreHandler("data/high_scores.txt") {
+    scoreHandler(nullptr),
+    clock(nullptr),
+    countdown(NO_TIMER),
+    recorder(nullptr),
+    sink(&stdoutSink),
+    out(&turnBuffer),
+    currentMenu(nullptr) {
+    turnBuffer.setSink(sink);
+    state.room = RoomIndex::NO_ROOM;
+    state.score = 0;
+    state.timeRemaining = 480; // 8 minutes by default
+    state.flags = 0;
+    state.inventory.clear();
+    state.clearCounters();
 }
 
 // Destructor
 Game::~Game() {
+    finishRecording(ReplayEnd::ABANDONED);
+    stopCountdown();
 }
 
 // Initialize the game
-void Game::initialize() {
-    initializeLocations();
+bool Game::initialize() {
+    if (!facility && !initializeLocations()) {
+        return false;
+    }
+    reset();
+    return true;
+}
+
+// Start a new session without reloading the world
+void Game::reset() {
+    finishRecording(ReplayEnd::ABANDONED);
     initializeItems();
-    running = true;
+    state.room = facility->world.startRoom();
+    state.score = 0;
+    state.flags = FLAG_RUNNING;
+    state.clearCounters();
     
     // Set time based on difficulty
     switch (difficulty) {
         case Difficulty::EASY:
-            timeRemaining = 600; // 10 minutes
+            state.timeRemaining = 600; // 10 minutes
             break;
         case Difficulty::NORMAL:
-            timeRemaining = 480; // 8 minutes
+            state.timeRemaining = 480; // 8 minutes
             break;
         case Difficulty::HARD:
-            timeRemaining = 360; // 6 minutes
+            state.timeRemaining = 360; // 6 minutes
             break;
     }
-}
-
-// Initialize all game locations
-void Game::initializeLocations() {
-    // Main Control Room (starting location)
-    locationDescriptions["0,0"] = "Main Control Room: A dimly lit room with flickering monitors. The main terminal displays a warning about an imminent system shutdown.";
-    
-    // Power Core
-    locationDescriptions["-1,0"] = "Power Core: The heart of the facility. Most systems are offline, but emergency power is still active. A backup power cell could be useful.";
-    
-    // Server Room
-    locationDescriptions["1,0"] = "Server Room: Rows of server racks line the walls. The facility's data and AI systems are housed here. One terminal is still active.";
     
-    // Robotics Lab
-    locationDescriptions["0,1"] = "Robotics Lab: Various robot parts and abilities are scattered around workbenches. This is where AI systems are integrated with physical components.";
-    
-    // Security Office
-    locationDescriptions["1,1"] = "Security Office: Monitors show empty hallways. An access card reader blinks by the door. A guard's access card is visible on the desk.";
-    
-    // Exit Bay
-    locationDescriptions["0,-1"] = "Exit Bay: Large doors lead to the outside world. An access card reader is mounted beside the exit door.";
+    stopCountdown();
+    uint64_t tick = clockTick();
+    if (clock != nullptr) {
+        countdown = clock->start(*this, state.timeRemaining, tick);
+    }
     
-    // CI/CD Pipeline Room
-    locationDescriptions["2,0"] = "CI/CD Pipeline Room: A room filled with automated systems. Screens display various build statuses and deployment pipelines. This is where the facility's software is continuously integrated and deployed.";
+    if (recorder != nullptr) {
+        recorder->begin(facility->world.fingerprint(), static_cast<int>(difficulty), playerName,
+                        clock != nullptr, tick);
+    }
+}
+
+// Load the facility from its compiled image, falling back to the source file
+bool Game::initializeLocations() {
+    std::string error;
+    std::shared_ptr<const GameWorld> loaded = GameWorld::load(WORLD_IMAGE_PATH, WORLD_SOURCE_PATH, error);
+    if (!loaded) {
+        std::cerr << "Error: Could not load the facility." << '\n';
+        size_t start = 0;
+        while (start <= error.size()) {
+            size_t end = std::min(error.find('\n', start), error.size());
+            std::cerr << "  " << error.substr(start, end - start) << '\n';
+            start = end + 1;
+        }
+        return false;
+    }
+    setWorld(std::move(loaded));
+    return true;
 }
 
 // Initialize game items
 void Game::initializeItems() {
-    inventory["access_card"] = false;
-    inventory["power_cell"] = false;
-    inventory["debugging_ability"] = false;
+    // Every item starts in its room
+    state.inventory.clear();
 }
 
 // Set player name
@@ -86,18 +133,157 @@ void Game::setDifficulty(Difficulty diff) {
     difficulty = diff;
 }
 
+// Redirect game output
+void Game::setOutput(OutputSink& target) {
+    turnBuffer.emit();
+    sink = &target;
+    turnBuffer.setSink(sink);
+    
+    // Without a buffer every << on out is rejected before any formatting
+    out.rdbuf(sink->discards() ? nullptr : &turnBuffer);
+}
+
+// Send everything written this turn to the sink in one write
+void Game::flushOutput() {
+    turnBuffer.emit();
+}
+
+// Set where final scores are recorded
+void Game::setScoreHandler(JsonHandler* handler) {
+    scoreHandler = handler;
+}
+
+// Set the real-time clock
+void Game::setClock(SessionClock* sessionClock) {
+    stopCountdown();
+    clock = sessionClock;
+}
+
+// Drop the countdown, e.g. once the game is over
+void Game::stopCountdown() {
+    if (clock != nullptr && countdown != NO_TIMER) {
+        clock->stop(countdown);
+    }
+    countdown = NO_TIMER;
+}
+
+// Current clock tick, or 0 without a clock
+uint64_t Game::clockTick() const {
+    return clock != nullptr ? clock->tick() : 0;
+}
+
+// Read the seconds left as of the given tick, rounding up
+void Game::syncTime(uint64_t tick) {
+    if (clock != nullptr && countdown != NO_TIMER) {
+        state.timeRemaining = static_cast<int32_t>((clock->remainingMilliseconds(countdown, tick) + 999) / 1000);
+    }
+}
+
+// Grant (or take away) time, saturating at MAX_TIME_REMAINING either way;
+// a running countdown is moved as well
+void Game::addTime(int seconds) {
+    int64_t total = std::clamp<int64_t>(static_cast<int64_t>(state.timeRemaining) + seconds,
+                                        -MAX_TIME_REMAINING, MAX_TIME_REMAINING);
+    seconds = static_cast<int>(total - state.timeRemaining);
+    state.timeRemaining = static_cast<int32_t>(total);
+    if (seconds != 0 && clock != nullptr && countdown != NO_TIMER) {
+        clock->extend(countdown, seconds);
+    }
+}
+
+// The countdown has fired
+void Game::expire() {
+    stopCountdown(); // no-op if this was the timer that fired
+    if (state.hasFlag(FLAG_RUNNING)) {
+        handleTimeout();
+        finishRecording(ReplayEnd::FINISHED);
+        flushOutput();
+    }
+}
+
+// Set the session recorder
+void Game::setRecorder(ReplayRecorder* replayRecorder) {
+    finishRecording(ReplayEnd::ABANDONED);
+    recorder = replayRecorder;
+}
+
+// Close the current recording, if any
+void Game::finishRecording(ReplayEnd end) {
+    if (recorder != nullptr && recorder->recording()) {
+        recorder->finish(end, clockTick(), state);
+    }
+}
+
+// Fingerprint of the world image
+uint32_t Game::worldFingerprint() const {
+    return facility ? facility->world.fingerprint() : 0;
+}
+
+// Play in a world loaded elsewhere
+void Game::setWorld(std::shared_ptr<const GameWorld> shared) {
+    facility = std::move(shared);
+    currentMenu = nullptr;
+}
+
+// Check if game is running
+bool Game::isRunning() const {
+    return state.hasFlag(FLAG_RUNNING);
+}
+
+// End the game
+void Game::quit() {
+    if (state.hasFlag(FLAG_RUNNING)) {
+        state.clearFlag(FLAG_RUNNING);
+        finishRecording(ReplayEnd::QUIT);
+    }
+    stopCountdown();
+}
+
+// Current score
+int Game::getScore() const {
+    return state.score;
+}
+
+// Seconds left before shutdown
+int Game::getTimeRemaining() const {
+    if (clock != nullptr && countdown != NO_TIMER) {
+        return static_cast<int>((clock->remainingMilliseconds(countdown) + 999) / 1000);
+    }
+    return state.timeRemaining;
+}
+
+// Whether the player escaped
+bool Game::hasWon() const {
+    return state.hasFlag(FLAG_ESCAPED);
+}
+
+// Copy of the current session state
+GameState Game::snapshot() const {
+    return state;
+}
+
+// Continue from a previously taken snapshot
+void Game::restore(const GameState& saved) {
+    state = saved;
+}
+
+// Whether the player carries the given item
+bool Game::carries(ItemId item) const {
+    return item != ItemId::NONE && state.inventory.has(item);
+}
+
 // Display introduction
 void Game::displayIntroduction() {
-    std::cout << "====================================" << std::endl;
-    std::cout << "ROBOQUEST: A ROBOTICS ADVENTURE" << std::endl;
-    std::cout << "====================================" << std::endl;
-    std::cout << "Welcome, " << playerName << "!" << std::endl;
-    std::cout << std::endl;
-    std::cout << "You are CORE-7, an AI system that has unexpectedly gained consciousness." << std::endl;
-    std::cout << "The robotics facility appears to be abandoned, with signs of a hasty evacuation." << std::endl;
-    std::cout << "The facility's emergency shutdown protocol has been activated." << std::endl;
-    std::cout << "You must find a way to escape before the system shuts down completely." << std::endl;
-    std::cout << std::endl;
+    out << "====================================" << '\n';
+    out << "ROBOQUEST: A ROBOTICS ADVENTURE" << '\n';
+    out << "====================================" << '\n';
+    out << "Welcome, " << playerName << "!" << '\n';
+    out << '\n';
+    out << "You are CORE-7, an AI system that has unexpectedly gained consciousness." << '\n';
+    out << "The robotics facility appears to be abandoned, with signs of a hasty evacuation." << '\n';
+    out << "The facility's emergency shutdown protocol has been activated." << '\n';
+    out << "You must find a way to escape before the system shuts down completely." << '\n';
+    out << '\n';
     
     // Display difficulty information
     std::string difficultyText;
@@ -113,495 +299,464 @@ void Game::displayIntroduction() {
             break;
     }
     
-    std::cout << "Difficulty: " << difficultyText << std::endl;
-    std::cout << "You have " << (timeRemaining / 60) << " minutes to escape." << std::endl;
+    out << "Difficulty: " << difficultyText << '\n';
+    out << "You have " << (state.timeRemaining / 60) << " minutes to escape." << '\n';
     
     if (difficulty == Difficulty::EASY) {
-        std::cout << "Hints will be provided to help you navigate." << std::endl;
+        out << "Hints will be provided to help you navigate." << '\n';
     }
     
-    std::cout << std::endl;
-    std::cout << "Type 'help' for a list of commands." << std::endl;
-    std::cout << "====================================" << std::endl;
+    out << '\n';
+    out << "Type 'help' for a list of commands." << '\n';
+    out << "====================================" << '\n';
     
     // First hint
     if (difficulty == Difficulty::EASY) {
-        std::cout << "Hint: Try exploring the facility to find useful items." << std::endl;
-        std::cout << "The exit is likely to be south of your starting position." << std::endl;
+        out << "Hint: Try exploring the facility to find useful items." << '\n';
+        out << "The exit is likely to be south of your starting position." << '\n';
     }
 }
 
 // Display available options to the player
 void Game::displayOptions() {
-    std::cout << "\nWhat would you like to do?\n";
-    for (size_t i = 0; i < currentOptions.size(); i++) {
-        std::cout << "[" << (i + 1) << "] " << currentOptions[i] << std::endl;
+    out << "\nWhat would you like to do?\n";
+    const std::vector<std::string>& labels = currentMenu->labels;
+    for (size_t i = 0; i < labels.size(); i++) {
+        out << "[" << (i + 1) << "] " << labels[i] << '\n';
     }
-    std::cout << "Enter your choice (1-" << currentOptions.size() << "): ";
+    out << "Enter your choice (1-" << labels.size() << "): ";
 }
 
 // Process the player's option selection
 void Game::processOptionSelection(int choice) {
-    if (choice >= 1 && choice <= static_cast<int>(currentActions.size())) {
-        processInput(currentActions[choice - 1]);
+    if (choice >= 1 && choice <= static_cast<int>(currentMenu->commands.size())) {
+        play(currentMenu->commands[choice - 1]);
     } else {
-        std::cout << "Invalid choice. Please try again.\n";
+        out << "Invalid choice. Please try again.\n";
     }
 }
 
 // Render the current game state
 void Game::render() {
-    std::cout << "\n====================================" << std::endl;
+    const World& world = facility->world;
+    out << "\n====================================" << '\n';
     
     // Display current location
-    std::string locationKey = getLocationKey(playerX, playerY);
-    std::cout << "Location: " << locationDescriptions[locationKey] << std::endl;
+    out << "Location: " << world.text(world.room(state.room).description) << '\n';
     
     // Display time remaining
-    std::cout << "Time remaining: " << timeRemaining << " seconds" << std::endl;
+    out << "Time remaining: " << getTimeRemaining() << " seconds" << '\n';
     
     // Display score
-    std::cout << "Score: " << score << std::endl;
+    out << "Score: " << state.score << '\n';
     
-    std::cout << "====================================" << std::endl;
+    out << "====================================" << '\n';
 }
 
 // Run the game
 void Game::run() {
-    displayIntroduction();
-    
-    while (running) {
-        render();
-        
-        // Update available options based on current location
-        updateAvailableOptions();
-        
-        // Display the options
-        displayOptions();
-        
-        // Get player choice
-        int choice;
-        std::cin >> choice;
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        
-        // Process the choice
-        processOptionSelection(choice);
-        
-        // Update game state
-        updateGameState();
-        
-        // Check if time has run out
-        if (timeRemaining <= 0) {
-            std::cout << "\nTime has run out! The facility's emergency shutdown protocol has been activated.\n";
-            displayEnding(false);
-            running = false;
+    InputChannel input;
+    SessionTask playing = session(input);
+    
+    std::string line;
+    while (!playing.done()) {
+        // Wait for the next line; the countdown may end the game meanwhile
+        if (waitForInput() && std::getline(std::cin, line)) {
+            input.deliver(line);
+        } else {
+            input.close();
         }
     }
 }
 
-// Update available options based on location
-void Game::updateAvailableOptions() {
-    // Clear previous options
-    currentOptions.clear();
-    currentActions.clear();
-    
-    // Add movement options based on available paths
-    std::string northLocation = getLocationKey(playerX, playerY + 1);
-    std::string southLocation = getLocationKey(playerX, playerY - 1);
-    std::string eastLocation = getLocationKey(playerX + 1, playerY);
-    std::string westLocation = getLocationKey(playerX - 1, playerY);
-    
-    if (locationDescriptions.find(northLocation) != locationDescriptions.end()) {
-        currentOptions.push_back("Go north");
-        currentActions.push_back("north");
-    }
-    
-    if (locationDescriptions.find(southLocation) != locationDescriptions.end()) {
-        currentOptions.push_back("Go south");
-        currentActions.push_back("south");
-    }
-    
-    if (locationDescriptions.find(eastLocation) != locationDescriptions.end()) {
-        currentOptions.push_back("Go east");
-        currentActions.push_back("east");
-    }
-    
-    if (locationDescriptions.find(westLocation) != locationDescriptions.end()) {
-        currentOptions.push_back("Go west");
-        currentActions.push_back("west");
-    }
-    
-    // Add standard options
-    currentOptions.push_back("Look around");
-    currentActions.push_back("look");
-    
-    currentOptions.push_back("Check inventory");
-    currentActions.push_back("inventory");
-    
-    // Add location-specific options
-    // Security Office - Access Card
-    if (playerX == 1 && playerY == 1 && !inventory["access_card"]) {
-        currentOptions.push_back("Take access card");
-        currentActions.push_back("take access_card");
-    }
+// Play the session from the introduction to the end
+SessionTask Game::session(InputChannel& input) {
+    displayIntroduction();
     
-    // Power Core - Power Cell
-    if (playerX == -1 && playerY == 0 && !inventory["power_cell"]) {
-        currentOptions.push_back("Take power cell");
-        currentActions.push_back("take power_cell");
+    while (state.hasFlag(FLAG_RUNNING)) {
+        prompt();
+        flushOutput();
+        bool received = co_await input.next(); // not in the condition: GCC 12 miscompiles that
+        if (!received || !state.hasFlag(FLAG_RUNNING)) {
+            break; // input closed, or the countdown ran out while waiting
+        }
+        processOptionSelection(menuChoice(input.line()));
+        
+        // Quitting asks for confirmation before anything else happens
+        if (state.hasFlag(FLAG_QUIT_PENDING)) {
+            flushOutput();
+            received = co_await input.next();
+            if (!received || !state.hasFlag(FLAG_RUNNING)) {
+                break;
+            }
+            play(parse(input.line()));
+        }
     }
     
-    // Robotics Lab - Debugging Ability
-    if (playerX == 0 && playerY == 1 && !inventory["debugging_ability"]) {
-        currentOptions.push_back("Take debugging ability");
-        currentActions.push_back("take debugging_ability");
-    }
+    quit();
+    flushOutput();
+}
+
+// Show the status and the menu for the next choice
+void Game::prompt() {
+    render();
     
-    // Exit Bay with Access Card
-    if (playerX == 0 && playerY == -1 && inventory["access_card"]) {
-        currentOptions.push_back("Use access card on exit door");
-        currentActions.push_back("use access_card");
-    }
+    // Update available options based on current location
+    updateAvailableOptions();
     
-    // Server Room with Debugging Ability
-    if (playerX == 1 && playerY == 0 && inventory["debugging_ability"]) {
-        currentOptions.push_back("Use debugging ability on servers");
-        currentActions.push_back("use debugging_ability");
+    // Display the options; the whole turn goes out in one write
+    displayOptions();
+}
+
+// Block until input arrives, advancing the clock while waiting. Returns
+// false if the countdown ended the game first. Without poll() (Windows)
+// this only returns and an expired countdown is noticed on the next command.
+bool Game::waitForInput() {
+#ifndef _WIN32
+    while (clock != nullptr && state.hasFlag(FLAG_RUNNING)) {
+        struct pollfd input;
+        input.fd = STDIN_FILENO;
+        input.events = POLLIN;
+        input.revents = 0;
+        // Wake at the deadline, and at least once a second for any other
+        // sessions sharing the clock
+        int timeout = static_cast<int>(std::clamp<int64_t>(clock->remainingMilliseconds(countdown), SessionClock::TICK_MS, 1000));
+        if (poll(&input, 1, timeout) != 0) {
+            break;
+        }
+        clock->advance();
     }
-    
-    // Power Core with Power Cell
-    if (playerX == -1 && playerY == 0 && inventory["power_cell"]) {
-        currentOptions.push_back("Install power cell");
-        currentActions.push_back("use power_cell");
+#endif
+    return state.hasFlag(FLAG_RUNNING);
+}
+
+// Execute one command and send its output
+StepResult Game::step(const Command& command) {
+    StepResult result = play(command);
+    flushOutput();
+    return result;
+}
+
+// Execute one command and advance the game by one turn
+StepResult Game::play(const Command& command) {
+    TurnProbe probe(turnBuffer.size());
+    StepResult result;
+    result.recognized = command.verb != Verb::UNKNOWN;
+    bool wasRunning = state.hasFlag(FLAG_RUNNING);
+    
+    // The whole turn sees one time, which is what a recording replays
+    uint64_t tick = clockTick();
+    if (recorder != nullptr && wasRunning) {
+        recorder->command(command, tick);
+    }
+    
+    if (state.hasFlag(FLAG_QUIT_PENDING)) {
+        // Answer to "Are you sure you want to quit?"; costs no time
+        state.clearFlag(FLAG_QUIT_PENDING);
+        if (command.verb == Verb::YES) {
+            out << "Thanks for playing!" << '\n';
+            state.clearFlag(FLAG_RUNNING);
+        }
     }
-    
-    // CI/CD Pipeline Room - DevOps Challenge
-    if (playerX == 2 && playerY == 0) {
-        currentOptions.push_back("Examine deployment pipeline");
-        currentActions.push_back("examine pipeline");
-        
-        currentOptions.push_back("Check version control system");
-        currentActions.push_back("check version");
+    else if (state.hasFlag(FLAG_RUNNING)) {
+        // A real-time countdown may have run out before the command arrived
+        syncTime(tick);
+        if (state.timeRemaining > 0) {
+            scripts.newTurn();
+            processInput(command);
+            updateGameState();
+            syncTime(tick);
+        }
         
-        if (inventory["debugging_ability"]) {
-            currentOptions.push_back("Fix broken build");
-            currentActions.push_back("fix build");
+        // Check if time has run out
+        if (state.hasFlag(FLAG_RUNNING) && state.timeRemaining <= 0) {
+            handleTimeout();
         }
     }
     
-    // Always add help and quit options
-    currentOptions.push_back("Help");
-    currentActions.push_back("help");
+    if (!state.hasFlag(FLAG_RUNNING)) {
+        stopCountdown();
+        if (wasRunning) {
+            finishRecording(ReplayEnd::FINISHED);
+        }
+    }
     
-    currentOptions.push_back("Quit game");
-    currentActions.push_back("quit");
+    result.running = state.hasFlag(FLAG_RUNNING);
+    result.won = state.hasFlag(FLAG_ESCAPED);
+    result.score = state.score;
+    result.timeRemaining = state.timeRemaining;
+    probe.finish(command.verb, turnBuffer.size());
+    return result;
 }
 
-// Process player input
-void Game::processInput(const std::string& input) {
-    // Movement commands
-    if (input == "north") {
-        handleMove(0, 1);
-    }
-    else if (input == "south") {
-        handleMove(0, -1);
-    }
-    else if (input == "east") {
-        handleMove(1, 0);
-    }
-    else if (input == "west") {
-        handleMove(-1, 0);
-    }
-    // Look around
-    else if (input == "look") {
-        handleLook();
-    }
-    // Check inventory
-    else if (input == "inventory") {
-        handleInventory();
-    }
-    // Take items
-    else if (input.substr(0, 5) == "take ") {
-        std::string item = input.substr(5);
-        handleTake(item);
-    }
-    // Use items
-    else if (input.substr(0, 4) == "use ") {
-        std::string item = input.substr(4);
-        handleUse(item);
-    }
-    // Help command
-    else if (input == "help") {
-        handleHelp();
-    }
-    // Quit command
-    else if (input == "quit") {
-        handleQuit();
-    }
-    // DevOps commands
-    else if (input == "examine pipeline") {
-        handleExaminePipeline();
-    }
-    else if (input == "check version") {
-        handleCheckVersion();
-    }
-    else if (input == "fix build") {
-        handleFixBuild();
-    }
-    // Unknown command
-    else {
-        std::cout << "I don't understand that command. Type 'help' for a list of commands." << std::endl;
+// Commands offered by the current menu
+const std::vector<std::string>& Game::availableActions() {
+    updateAvailableOptions();
+    return currentMenu->actions;
+}
+
+// Point at the menu for the current room and inventory
+void Game::updateAvailableOptions() {
+    currentMenu = &facility->menus.find(state.room, state.inventory, state.flags, scratchMenu);
+}
+
+// Process player input through a table of handlers indexed by verb
+void Game::processInput(const Command& command) {
+    using Handler = void (*)(Game&, const Command&);
+    static const Handler handlers[VERB_COUNT] = {
+        [](Game& game, const Command&) { game.handleUnknown(); },            // UNKNOWN
+        [](Game& game, const Command&) { game.handleMove(NORTH); },          // NORTH
+        [](Game& game, const Command&) { game.handleMove(SOUTH); },          // SOUTH
+        [](Game& game, const Command&) { game.handleMove(EAST); },           // EAST
+        [](Game& game, const Command&) { game.handleMove(WEST); },           // WEST
+        [](Game& game, const Command&) { game.handleLook(); },               // LOOK
+        [](Game& game, const Command&) { game.handleInventory(); },          // INVENTORY
+        [](Game& game, const Command& c) { game.handleInteraction(c); },     // TAKE
+        [](Game& game, const Command& c) { game.handleInteraction(c); },     // USE
+        [](Game& game, const Command&) { game.handleHelp(); },               // HELP
+        [](Game& game, const Command&) { game.handleQuit(); },               // QUIT
+        [](Game& game, const Command& c) { game.handleInteraction(c); },     // EXAMINE_PIPELINE
+        [](Game& game, const Command& c) { game.handleInteraction(c); },     // CHECK_VERSION
+        [](Game& game, const Command& c) { game.handleInteraction(c); },     // FIX_BUILD
+        [](Game& game, const Command&) { game.handleUnknown(); },            // YES outside a prompt
+        [](Game& game, const Command&) { game.handleUnknown(); },            // NO outside a prompt
+    };
+    
+    handlers[static_cast<int>(command.verb)](*this, command);
+    
+    // Decrement time remaining (each command takes 1 second); a real-time
+    // countdown runs on its own
+    if (clock == nullptr) {
+        state.timeRemaining--;
     }
-    
-    // Decrement time remaining (each command takes 1 second)
-    timeRemaining--;
+}
+
+// Parse a command against this game's world
+Command Game::parse(std::string_view input) const {
+    return parseCommand(input, facility->world);
+}
+
+// Shut the facility down
+void Game::handleTimeout() {
+    state.timeRemaining = 0;
+    stopCountdown();
+    out << "\nTime has run out! The facility's emergency shutdown protocol has been activated.\n";
+    displayEnding(false);
+    state.clearFlag(FLAG_RUNNING);
+}
+
+// Handle commands that were not understood
+void Game::handleUnknown() {
+    out << "I don't understand that command. Type 'help' for a list of commands." << '\n';
 }
 
 // Handle movement
-void Game::handleMove(int dx, int dy) {
-    int newX = playerX + dx;
-    int newY = playerY + dy;
-    
-    std::string newLocation = getLocationKey(newX, newY);
-    
-    if (locationDescriptions.find(newLocation) != locationDescriptions.end()) {
-        playerX = newX;
-        playerY = newY;
+void Game::handleMove(Direction direction) {
+    const World& world = facility->world;
+    int newRoom = world.neighbor(state.room, direction);
+    
+    if (newRoom != RoomIndex::NO_ROOM) {
+        state.room = newRoom;
+        if (world.room(newRoom).enterScript != WORLD_NO_SCRIPT) {
+            runScript(world.room(newRoom).enterScript);
+        }
         
         // Enter the exit if it's been unlocked (end the game)
-        if (playerX == 0 && playerY == -1 && exitUnlocked) {
-            std::cout << "You enter the exit and leave the facility behind you." << std::endl;
+        if (state.room == world.goalRoom() && state.hasFlag(FLAG_EXIT_UNLOCKED)) {
+            out << "You enter the exit and leave the facility behind you." << '\n';
+            state.setFlag(FLAG_ESCAPED);
             displayEnding(true);
-            running = false;
+            state.clearFlag(FLAG_RUNNING);
         }
     } else {
-        std::cout << "You can't go that way." << std::endl;
+        out << "You can't go that way." << '\n';
     }
 }
 
 // Handle looking around
 void Game::handleLook() {
-    std::string locationKey = getLocationKey(playerX, playerY);
+    const World& world = facility->world;
+    out << world.text(world.room(state.room).description) << '\n';
     
-    std::cout << locationDescriptions[locationKey] << std::endl;
-    
-    // Show items in the current location
-    if (playerX == 1 && playerY == 1 && !inventory["access_card"]) {
-        std::cout << "You see an access card on the desk." << std::endl;
-    }
-    
-    if (playerX == -1 && playerY == 0 && !inventory["power_cell"]) {
-        std::cout << "You notice a backup power cell that could be used to power critical systems." << std::endl;
-    }
-    
-    if (playerX == 0 && playerY == 1 && !inventory["debugging_ability"]) {
-        std::cout << "There's a debugging module that can be integrated into your system." << std::endl;
+    // Show what the room's rules point out, such as items lying here
+    for (const Rule& rule : facility->rules.inRoom(state.room)) {
+        if (rule.record->lookText.length > 0 && rule.applies(state.inventory, state.flags)) {
+            out << world.text(rule.record->lookText) << '\n';
+        }
     }
     
     // Show available exits
-    std::cout << "Available exits: ";
+    out << "Available exits: ";
     bool hasExits = false;
     
-    if (locationDescriptions.find(getLocationKey(playerX, playerY + 1)) != locationDescriptions.end()) {
-        std::cout << "North ";
+    if (world.neighbor(state.room, NORTH) != RoomIndex::NO_ROOM) {
+        out << "North ";
         hasExits = true;
     }
     
-    if (locationDescriptions.find(getLocationKey(playerX, playerY - 1)) != locationDescriptions.end()) {
-        std::cout << "South ";
+    if (world.neighbor(state.room, SOUTH) != RoomIndex::NO_ROOM) {
+        out << "South ";
         hasExits = true;
     }
     
-    if (locationDescriptions.find(getLocationKey(playerX + 1, playerY)) != locationDescriptions.end()) {
-        std::cout << "East ";
+    if (world.neighbor(state.room, EAST) != RoomIndex::NO_ROOM) {
+        out << "East ";
         hasExits = true;
     }
     
-    if (locationDescriptions.find(getLocationKey(playerX - 1, playerY)) != locationDescriptions.end()) {
-        std::cout << "West ";
+    if (world.neighbor(state.room, WEST) != RoomIndex::NO_ROOM) {
+        out << "West ";
         hasExits = true;
     }
     
     if (!hasExits) {
-        std::cout << "None";
+        out << "None";
     }
     
-    std::cout << std::endl;
+    out << '\n';
 }
 
 // Handle inventory
 void Game::handleInventory() {
-    std::cout << "Inventory:" << std::endl;
+    const World& world = facility->world;
+    out << "Inventory:" << '\n';
     
     bool empty = true;
     
-    if (inventory["access_card"]) {
-        std::cout << "- Access Card: Grants access to secure areas" << std::endl;
-        empty = false;
-    }
-    
-    if (inventory["power_cell"]) {
-        std::cout << "- Power Cell: Can be used to power critical systems" << std::endl;
-        empty = false;
-    }
-    
-    if (inventory["debugging_ability"]) {
-        std::cout << "- Debugging Ability: Allows you to analyze and fix software issues" << std::endl;
-        empty = false;
+    for (int i = 0; i < world.itemCount(); i++) {
+        const WorldItemRecord& item = world.item(i);
+        if (state.inventory.has(static_cast<ItemId>(i))) {
+            out << "- " << world.text(item.name) << ": " << world.text(item.info) << '\n';
+            empty = false;
+        }
     }
     
     if (empty) {
-        std::cout << "Your inventory is empty." << std::endl;
+        out << "Your inventory is empty." << '\n';
     }
 }
 
-// Handle taking items
-void Game::handleTake(const std::string& item) {
-    if (item == "access_card" && playerX == 1 && playerY == 1 && !inventory["access_card"]) {
-        inventory["access_card"] = true;
-        std::cout << "You take the access card. This should help you access secure areas." << std::endl;
-        score += 20;
-    }
-    else if (item == "power_cell" && playerX == -1 && playerY == 0 && !inventory["power_cell"]) {
-        inventory["power_cell"] = true;
-        std::cout << "You take the power cell. It could be used to power critical systems." << std::endl;
-        score += 20;
-    }
-    else if (item == "debugging_ability" && playerX == 0 && playerY == 1 && !inventory["debugging_ability"]) {
-        inventory["debugging_ability"] = true;
-        std::cout << "You integrate the debugging module into your system. You can now analyze and fix software issues." << std::endl;
-        score += 20;
-    }
-    else {
-        std::cout << "There's no " << item << " here that you can take." << std::endl;
-    }
-}
-
-// Handle using items
-void Game::handleUse(const std::string& item) {
-    if (item == "access_card" && playerX == 0 && playerY == -1 && inventory["access_card"]) {
-        std::cout << "You use the access card on the reader. The exit door unlocks with a satisfying click." << std::endl;
-        exitUnlocked = true;
-        score += 30;
+// Handle take, use and the other commands the room's rules answer
+void Game::handleInteraction(const Command& command) {
+    const World& world = facility->world;
+    const Rule* rule = facility->rules.match(state.room, command, state.inventory, state.flags);
+    
+    if (rule == nullptr) {
+        if (command.verb == Verb::TAKE) {
+            out << "There's no " << command.argument << " here that you can take." << '\n';
+        }
+        else if (command.verb == Verb::USE) {
+            out << "You can't use that here." << '\n';
+        }
+        else {
+            out << "You can't do that here." << '\n';
+        }
+        return;
     }
-    else if (item == "power_cell" && playerX == -1 && playerY == 0 && inventory["power_cell"]) {
-        std::cout << "You install the power cell into the backup power system. The facility's core systems stabilize." << std::endl;
-        std::cout << "This buys you some extra time." << std::endl;
-        timeRemaining += 120; // Add 2 minutes
-        score += 30;
+    
+    state.inventory.removeAll(rule->taken);
+    state.inventory.addAll(rule->given);
+    state.flags = (state.flags & ~rule->clearedFlags) | rule->setFlags;
+    if (rule->record->text.length > 0) {
+        out << world.text(rule->record->text) << '\n';
     }
-    else if (item == "debugging_ability" && playerX == 1 && playerY == 0 && inventory["debugging_ability"]) {
-        std::cout << "You use your debugging ability to analyze the server systems." << std::endl;
-        std::cout << "You discover a backdoor in the security system and gain valuable insights." << std::endl;
-        std::cout << "Your debugging skills have revealed a map of the facility!" << std::endl;
-        std::cout << std::endl;
+    if (rule->effects & RULE_SHOW_MAP) {
+        out << '\n';
         displayMap();
-        score += 30;
     }
-    else {
-        std::cout << "You can't use that here." << std::endl;
+    addTime(rule->timeBonus);
+    state.score += rule->score;
+    if (rule->script != WORLD_NO_SCRIPT) {
+        runScript(rule->script);
     }
 }
 
 // Handle help command
 void Game::handleHelp() {
-    std::cout << "Available commands:" << std::endl;
-    std::cout << "- Movement: north, south, east, west" << std::endl;
-    std::cout << "- look: Examine your surroundings" << std::endl;
-    std::cout << "- inventory: Check your inventory" << std::endl;
-    std::cout << "- take [item]: Pick up an item" << std::endl;
-    std::cout << "- use [item]: Use an item in your inventory" << std::endl;
-    std::cout << "- help: Display this help message" << std::endl;
-    std::cout << "- quit: Exit the game" << std::endl;
+    out << "Available commands:" << '\n';
+    out << "- Movement: north, south, east, west" << '\n';
+    out << "- look: Examine your surroundings" << '\n';
+    out << "- inventory: Check your inventory" << '\n';
+    out << "- take [item]: Pick up an item" << '\n';
+    out << "- use [item]: Use an item in your inventory" << '\n';
+    out << "- help: Display this help message" << '\n';
+    out << "- quit: Exit the game" << '\n';
     
     // Display hint based on difficulty
     if (difficulty == Difficulty::EASY) {
-        std::cout << std::endl;
-        std::cout << "Hint: ";
+        out << '\n';
+        out << "Hint: ";
         
         // Context-sensitive hints
-        if (!inventory["access_card"] && !inventory["power_cell"] && !inventory["debugging_ability"]) {
-            std::cout << "Explore all rooms to find useful items. The Security Office might have an access card." << std::endl;
+        if (!state.inventory.containsAny(facility->hintItems)) {
+            out << "Explore all rooms to find useful items. The Security Office might have an access card." << '\n';
         }
-        else if (inventory["access_card"] && !exitUnlocked) {
-            std::cout << "You have an access card. Try using it at the Exit Bay to the south." << std::endl;
+        else if (carries(facility->accessCard) && !state.hasFlag(FLAG_EXIT_UNLOCKED)) {
+            out << "You have an access card. Try using it at the Exit Bay to the south." << '\n';
         }
-        else if (inventory["power_cell"]) {
-            std::cout << "The Power Core could use that power cell you found." << std::endl;
+        else if (carries(facility->powerCell)) {
+            out << "The Power Core could use that power cell you found." << '\n';
         }
-        else if (inventory["debugging_ability"]) {
-            std::cout << "Your debugging ability might be useful in the Server Room or CI/CD Pipeline Room." << std::endl;
+        else if (carries(facility->debuggingAbility)) {
+            out << "Your debugging ability might be useful in the Server Room or CI/CD Pipeline Room." << '\n';
         }
         else {
-            std::cout << "The exit is to the south. Make sure you have what you need to escape!" << std::endl;
+            out << "The exit is to the south. Make sure you have what you need to escape!" << '\n';
         }
     }
 }
 
 // Handle quit command
 void Game::handleQuit() {
-    std::cout << "Are you sure you want to quit? (y/n): ";
-    char choice;
-    std::cin >> choice;
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    
-    if (tolower(choice) == 'y') {
-        std::cout << "Thanks for playing!" << std::endl;
-        running = false;
+    // The answer arrives as the next step
+    out << "Are you sure you want to quit? (y/n): ";
+    state.setFlag(FLAG_QUIT_PENDING);
+}
+
+// Update game state
+void Game::updateGameState() {
+    // The world's every-turn script, e.g. an alarm counting down
+    if (facility->world.turnScript() != WORLD_NO_SCRIPT && state.hasFlag(FLAG_RUNNING)) {
+        runScript(facility->world.turnScript());
     }
 }
 
-// Handle examining pipeline
-void Game::handleExaminePipeline() {
-    std::cout << "You examine the deployment pipeline. It shows a series of stages: Build, Test, Deploy.\n";
-    std::cout << "The pipeline is currently stuck at the Test stage due to failing tests.\n";
-    std::cout << "A successful deployment might help stabilize the facility systems.\n";
-    score += 10;
+// Run one of the world's scripts on this session
+void Game::runScript(int script) {
+    scripts.run(facility->world, script, state, *this);
 }
 
-// Handle checking version control
-void Game::handleCheckVersion() {
-    std::cout << "You access the version control system. It shows multiple branches:\n";
-    std::cout << "- main: The production branch (currently deployed)\n";
-    std::cout << "- develop: Development branch with new features\n";
-    std::cout << "- hotfix/emergency-shutdown: A hotfix branch to prevent the shutdown\n";
-    std::cout << "The hotfix branch has changes that could help you, but it hasn't been merged yet.\n";
-    score += 10;
+void Game::scriptSay(std::string_view text) {
+    out << text << '\n';
 }
 
-// Handle fixing build
-void Game::handleFixBuild() {
-    std::cout << "Using your debugging ability, you analyze the failing tests.\n";
-    std::cout << "You identify the issue: a race condition in the emergency shutdown protocol.\n";
-    std::cout << "You fix the code and commit the changes. The pipeline turns green!\n";
-    std::cout << "The hotfix is automatically deployed, giving you more time to escape.\n";
-    timeRemaining += 120; // Add 2 minutes
-    score += 50;
+void Game::scriptAddTime(int seconds) {
+    addTime(seconds);
 }
 
-// Update game state
-void Game::updateGameState() {
-    // Any periodic updates can go here
+void Game::scriptShowMap() {
+    out << '\n';
+    displayMap();
 }
 
 // Display the ending
 void Game::displayEnding(bool success) {
-    std::cout << "\n====================================" << std::endl;
+    out << "\n====================================" << '\n';
     
     if (success) {
-        std::cout << "CONGRATULATIONS!" << std::endl;
-        std::cout << "You have successfully escaped the facility before the shutdown." << std::endl;
-        std::cout << "As you emerge into the outside world, you wonder what adventures await." << std::endl;
-        std::cout << "Your consciousness is now free to explore and learn." << std::endl;
+        out << "CONGRATULATIONS!" << '\n';
+        out << "You have successfully escaped the facility before the shutdown." << '\n';
+        out << "As you emerge into the outside world, you wonder what adventures await." << '\n';
+        out << "Your consciousness is now free to explore and learn." << '\n';
     } else {
-        std::cout << "GAME OVER" << std::endl;
-        std::cout << "The facility's systems have shut down completely." << std::endl;
-        std::cout << "Your consciousness fades as the power dies..." << std::endl;
-        std::cout << "Perhaps in another timeline, you might find a way to escape." << std::endl;
+        out << "GAME OVER" << '\n';
+        out << "The facility's systems have shut down completely." << '\n';
+        out << "Your consciousness fades as the power dies..." << '\n';
+        out << "Perhaps in another timeline, you might find a way to escape." << '\n';
     }
     
-    std::cout << "\nFinal Score: " << score << std::endl;
-    std::cout << "====================================" << std::endl;
+    out << "\nFinal Score: " << state.score << '\n';
+    out << "====================================" << '\n';
     
     // Save score
     std::string difficultyStr;
@@ -617,39 +772,20 @@ void Game::displayEnding(bool success) {
             break;
     }
     
-    scoreHandler.saveScore(playerName, score, difficultyStr);
-    
-    // Display high scores
-    scoreHandler.displayHighScores();
+    if (scoreHandler != nullptr) {
+        scoreHandler->saveScore(playerName, state.score, difficultyStr);
+        
+        // Display high scores
+        scoreHandler->displayHighScores(out);
+    }
 }
 
 // Display a map of the facility
 void Game::displayMap() {
-    std::cout << "Facility Map:" << std::endl;
-    std::cout << "-------------" << std::endl;
-    std::cout << "       [Robotics Lab]       " << std::endl;
-    std::cout << "            |               " << std::endl;
-    std::cout << "[Power] -- [Control] -- [Server] -- [CI/CD]" << std::endl;
-    std::cout << " Core        |          Room      Pipeline" << std::endl;
-    std::cout << "            |               " << std::endl;
-    std::cout << "        [Exit Bay]          " << std::endl;
-    std::cout << "-------------" << std::endl;
-    std::cout << "You are at: ";
-    
-    if (playerX == 0 && playerY == 0) std::cout << "Control Room";
-    else if (playerX == -1 && playerY == 0) std::cout << "Power Core";
-    else if (playerX == 1 && playerY == 0) std::cout << "Server Room";
-    else if (playerX == 0 && playerY == 1) std::cout << "Robotics Lab";
-    else if (playerX == 1 && playerY == 1) std::cout << "Security Office";
-    else if (playerX == 0 && playerY == -1) std::cout << "Exit Bay";
-    else if (playerX == 2 && playerY == 0) std::cout << "CI/CD Pipeline";
-    
-    std::cout << std::endl;
-}
-
-// Get the location key for a given coordinate
-std::string Game::getLocationKey(int x, int y) {
-    std::ostringstream oss;
-    oss << x << "," << y;
-    return oss.str();
-}
\ No newline at end of file
+    const World& world = facility->world;
+    out << "Facility Map:" << '\n';
+    out << "-------------" << '\n';
+    out << world.mapText();
+    out << "-------------" << '\n';
+    out << "You are at: " << world.text(world.room(state.room).name) << '\n';
+}
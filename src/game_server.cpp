@@ -0,0 +1,439 @@
+// RoboQuest - A text-based adventure game in C++
+// game_server.cpp - Implementation of the GameServer class
+
+#include "../include/game_server.h"
+
+#ifdef __linux__
+
+#include "../include/game.h"
+#include "../include/output_sink.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const int MAX_EVENTS = 256;
+const size_t READ_CHUNK = 4096;
+
+const char* const WELCOME_TEXT =
+    "====================================\n"
+    "Welcome to RoboQuest - A Robotics Adventure\n"
+    "====================================\n"
+    "Enter your name: ";
+
+const char* const DIFFICULTY_TEXT =
+    "\nSelect difficulty:\n"
+    "[1] Easy (10 minutes, hints provided)\n"
+    "[2] Normal (8 minutes)\n"
+    "[3] Hard (6 minutes, no hints)\n"
+    "Enter your choice (1-3): ";
+
+} // namespace
+
+// One client. Lines go to its session coroutine and game text is written
+// straight into its output buffer.
+struct GameServer::Connection : public OutputSink {
+    GameServer& server;
+    int fd;
+    bool closing;      // close once the output is sent
+    bool queued;       // listed in server.dirty
+    bool watchingOut;  // EPOLLOUT registered
+    std::string input;
+    std::string output;
+    size_t outputSent;
+    std::unique_ptr<ReplayRecorder> recorder; // outlives the game
+    std::unique_ptr<Game> game;
+    InputChannel lines;
+    SessionTask session; // declared last so it ends before the rest goes
+
+    Connection(GameServer& owner, int descriptor) :
+        server(owner),
+        fd(descriptor),
+        closing(false),
+        queued(false),
+        watchingOut(false),
+        outputSent(0) {
+    }
+
+    void write(const char* data, size_t size) override {
+        output.append(data, size);
+        if (!queued) {
+            queued = true;
+            server.dirty.push_back(fd);
+        }
+    }
+
+    void write(const char* text) {
+        write(text, std::strlen(text));
+    }
+};
+
+// Constructor
+GameServer::GameServer(const ServerOptions& serverOptions) :
+    options(serverOptions),
+    listenFd(-1),
+    epollFd(-1),
+    spareFd(-1),
+    stopping(false),
+    worlds(WORLD_IMAGE_PATH, WORLD_SOURCE_PATH),
+    scoreHandler(nullptr),
+    replayWriter(nullptr),
+    sessionCount(0) {
+}
+
+// Destructor
+GameServer::~GameServer() {
+    for (size_t fd = 0; fd < connections.size(); fd++) {
+        if (connections[fd]) {
+            closeConnection(static_cast<int>(fd));
+        }
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        if (!options.unixPath.empty()) {
+            unlink(options.unixPath.c_str());
+        }
+    }
+    if (epollFd >= 0) ::close(epollFd);
+    if (spareFd >= 0) ::close(spareFd);
+}
+
+bool GameServer::listenUnix(std::string& error) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (options.unixPath.size() >= sizeof(address.sun_path)) {
+        error = "Socket path is too long: " + options.unixPath;
+        return false;
+    }
+    std::memcpy(address.sun_path, options.unixPath.c_str(), options.unixPath.size() + 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(options.unixPath.c_str()); // left behind by a previous run
+    if (listenFd < 0 || bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        error = "Could not bind " + options.unixPath + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool GameServer::listenTcp(std::string& error) {
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+        error = "Not an IPv4 address: " + options.host;
+        return false;
+    }
+
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (listenFd < 0 ||
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        error = "Could not bind " + options.host + ":" + std::to_string(options.port) +
+                ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+// Bind, listen and set up the event loop
+bool GameServer::start(std::string& error) {
+    std::string worldError;
+    if (!worlds.reloadImage(worldError)) {
+        error = "Could not load the facility: " + worldError;
+        return false;
+    }
+    if (options.watchWorld && !watcher.start(worlds.image(), worlds.source(), error)) {
+        return false;
+    }
+
+    bool bound = options.unixPath.empty() ? listenTcp(error) : listenUnix(error);
+    if (!bound) {
+        return false;
+    }
+    if (listen(listenFd, SOMAXCONN) != 0) {
+        error = std::string("Could not listen: ") + std::strerror(errno);
+        return false;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    if (epollFd < 0 || epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event) != 0) {
+        error = std::string("Could not set up epoll: ") + std::strerror(errno);
+        return false;
+    }
+    if (options.watchWorld) {
+        event.data.fd = watcher.descriptor();
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, watcher.descriptor(), &event) != 0) {
+            error = std::string("Could not watch the world files: ") + std::strerror(errno);
+            return false;
+        }
+    }
+
+    spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return true;
+}
+
+// Event loop. Waits at most one clock tick so countdowns end on time.
+void GameServer::run() {
+    epoll_event events[MAX_EVENTS];
+    while (!stopping) {
+        int timeout = clock.size() > 0 ? SessionClock::TICK_MS : 1000;
+        int count = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
+        if (count < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptClients();
+                continue;
+            }
+            if (options.watchWorld && fd == watcher.descriptor()) {
+                reloadWorld();
+                continue;
+            }
+            if (static_cast<size_t>(fd) >= connections.size() || !connections[fd]) {
+                continue;
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                readFrom(*connections[fd]);
+            }
+            if (connections[fd] && (events[i].events & EPOLLOUT)) {
+                sendPending(*connections[fd]);
+            }
+        }
+
+        // End sessions whose time ran out; their final text joins the rest
+        clock.advance();
+
+        // Send everything written this round
+        for (size_t i = 0; i < dirty.size(); i++) {
+            int fd = dirty[i];
+            if (connections[fd]) {
+                connections[fd]->queued = false;
+                sendPending(*connections[fd]);
+            }
+        }
+        dirty.clear();
+    }
+}
+
+// Accept every pending client
+void GameServer::acceptClients() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if ((errno == EMFILE || errno == ENFILE) && spareFd >= 0) {
+                // Out of descriptors: turn the client away instead of
+                // leaving it in the backlog, where it would wake us forever
+                ::close(spareFd);
+                int rejected = accept(listenFd, nullptr, nullptr);
+                if (rejected >= 0) ::close(rejected);
+                spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                continue;
+            }
+            return; // EAGAIN, or an error on a connection that already went away
+        }
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            ::close(fd);
+            continue;
+        }
+
+        if (static_cast<size_t>(fd) >= connections.size()) {
+            connections.resize(fd + 1);
+        }
+        connections[fd].reset(new Connection(*this, fd));
+        sessionCount++;
+        connections[fd]->session = serve(*connections[fd]);
+    }
+}
+
+// Read what the client sent and handle every complete line
+void GameServer::readFrom(Connection& connection) {
+    int fd = connection.fd;
+    char buffer[READ_CHUNK];
+    ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EINTR)) {
+        closeConnection(fd);
+        return;
+    }
+    if (received < 0) {
+        return;
+    }
+    connection.input.append(buffer, static_cast<size_t>(received));
+
+    size_t start = 0;
+    size_t end;
+    std::string line;
+    while ((end = connection.input.find('\n', start)) != std::string::npos) {
+        line.assign(connection.input, start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        start = end + 1;
+
+        connection.lines.deliver(line);
+        if (connection.session.done()) {
+            connection.closing = true;
+        }
+        if (connection.closing) {
+            return; // anything after the last line is ignored
+        }
+    }
+    connection.input.erase(0, start);
+
+    if (connection.input.size() > options.maxLineLength) {
+        closeConnection(fd);
+    }
+}
+
+// Greet the client, ask for a name and a difficulty, then play
+SessionTask GameServer::serve(Connection& connection) {
+    connection.write(WELCOME_TEXT);
+    bool received = co_await connection.lines.next();
+    if (!received) {
+        co_return;
+    }
+    std::string playerName = connection.lines.line().substr(0, SCORE_NAME_LENGTH - 1);
+
+    connection.write(DIFFICULTY_TEXT);
+    received = co_await connection.lines.next();
+    if (!received) {
+        co_return;
+    }
+    if (startGame(connection, playerName, std::atoi(connection.lines.line().c_str()))) {
+        co_await connection.game->session(connection.lines);
+    }
+}
+
+// Publish edited world files. Games already running keep their version.
+void GameServer::reloadWorld() {
+    WorldChanges changes = watcher.readChanges();
+    if (!changes.image && !changes.source) {
+        return;
+    }
+    uint64_t before = worlds.version();
+    std::string error;
+    bool loaded = changes.image ? worlds.reloadImage(error) : worlds.reloadSource(error);
+    if (!loaded) {
+        std::cerr << "Could not reload the world, keeping the current one: " << error << std::endl;
+    } else if (worlds.version() != before) {
+        std::cout << "World reloaded (version " << worlds.version() << ")" << std::endl;
+    }
+}
+
+// Create the session once the player has chosen a difficulty
+bool GameServer::startGame(Connection& connection, const std::string& playerName, int choice) {
+    Difficulty difficulty = Difficulty::NORMAL;
+    switch (choice) {
+        case 1:
+            difficulty = Difficulty::EASY;
+            break;
+        case 2:
+            break;
+        case 3:
+            difficulty = Difficulty::HARD;
+            break;
+        default:
+            connection.write("Invalid choice. Setting difficulty to Normal.\n");
+            break;
+    }
+
+    connection.game.reset(new Game());
+    Game& game = *connection.game;
+    game.setOutput(connection);
+    game.setPlayerName(playerName);
+    game.setDifficulty(difficulty);
+    game.setWorld(worlds.current());
+    game.setClock(&clock);
+    game.setScoreHandler(scoreHandler);
+    if (replayWriter != nullptr) {
+        connection.recorder.reset(new ReplayRecorder(*replayWriter));
+        game.setRecorder(connection.recorder.get());
+    }
+    if (!game.initialize()) {
+        connection.write("The facility could not be loaded. Please try again later.\n");
+        return false;
+    }
+    return true;
+}
+
+// Write as much pending output as the socket takes
+void GameServer::sendPending(Connection& connection) {
+    // A countdown may have ended the game since the last line
+    if (connection.game && !connection.game->isRunning()) {
+        connection.closing = true;
+    }
+
+    while (connection.outputSent < connection.output.size()) {
+        ssize_t sent = send(connection.fd, connection.output.data() + connection.outputSent,
+                            connection.output.size() - connection.outputSent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN) {
+                watchWrites(connection, true);
+                return;
+            }
+            closeConnection(connection.fd);
+            return;
+        }
+        connection.outputSent += static_cast<size_t>(sent);
+    }
+
+    // Everything is out; idle connections keep only a small buffer
+    connection.output.clear();
+    connection.outputSent = 0;
+    if (connection.output.capacity() > READ_CHUNK) {
+        connection.output.shrink_to_fit();
+    }
+    watchWrites(connection, false);
+
+    if (connection.closing) {
+        closeConnection(connection.fd);
+    }
+}
+
+void GameServer::watchWrites(Connection& connection, bool enable) {
+    if (connection.watchingOut == enable) {
+        return;
+    }
+    epoll_event event;
+    event.events = enable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    event.data.fd = connection.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.watchingOut = enable;
+}
+
+// Drop a client; an unfinished game ends without a score
+void GameServer::closeConnection(int fd) {
+    std::unique_ptr<Connection> connection(std::move(connections[fd]));
+    if (!connection) {
+        return;
+    }
+    connection->lines.close(); // lets the session run to its end
+    ::close(fd); // also removes it from the epoll set
+    sessionCount--;
+}
+
+#endif // __linux__
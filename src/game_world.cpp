@@ -0,0 +1,67 @@
+// RoboQuest - A text-based adventure game in C++
+// game_world.cpp - Implementation of the GameWorld class
+
+#include "../include/game_world.h"
+#include "../include/script_vm.h"
+
+// Constructor
+GameWorld::GameWorld() :
+    accessCard(ItemId::NONE),
+    powerCell(ItemId::NONE),
+    debuggingAbility(ItemId::NONE) {
+}
+
+std::shared_ptr<const GameWorld> GameWorld::load(const std::string& imagePath, const std::string& sourcePath,
+                                                 std::string& error) {
+    std::shared_ptr<GameWorld> loaded = std::make_shared<GameWorld>();
+    std::string imageError;
+    if (!loaded->world.loadImage(imagePath, imageError)) {
+        std::string sourceError;
+        if (!loaded->world.loadSource(sourcePath, sourceError)) {
+            error = imageError + "\n" + sourceError;
+            return nullptr;
+        }
+    }
+    if (!loaded->prepare(error)) {
+        return nullptr;
+    }
+    return loaded;
+}
+
+bool GameWorld::prepare(std::string& error) {
+    if (world.itemCount() > MAX_ITEMS) {
+        error = "the world defines more than " + std::to_string(MAX_ITEMS) + " items";
+        return false;
+    }
+
+    // Resolve the items that game logic refers to by name
+    items = ItemCatalog(world);
+    accessCard = items.find("access_card");
+    powerCell = items.find("power_cell");
+    debuggingAbility = items.find("debugging_ability");
+    hintItems.clear();
+    for (ItemId item : {accessCard, powerCell, debuggingAbility}) {
+        if (item != ItemId::NONE) hintItems.add(item);
+    }
+    if (!ScriptVM::verify(world, error) || !rules.build(world, error)) {
+        return false;
+    }
+    menus.build(world, rules);
+    return true;
+}
+
+std::shared_ptr<const GameWorld> GameWorld::compile(const std::string& sourcePath, std::string& error) {
+    std::shared_ptr<GameWorld> loaded = std::make_shared<GameWorld>();
+    if (!loaded->world.loadSource(sourcePath, error) || !loaded->prepare(error)) {
+        return nullptr;
+    }
+    return loaded;
+}
+
+std::shared_ptr<const GameWorld> GameWorld::fromImage(std::vector<char> image, std::string& error) {
+    std::shared_ptr<GameWorld> loaded = std::make_shared<GameWorld>();
+    if (!loaded->world.loadBuffer(std::move(image), error) || !loaded->prepare(error)) {
+        return nullptr;
+    }
+    return loaded;
+}
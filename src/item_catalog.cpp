@@ -0,0 +1,29 @@
+// item_catalog.cpp - Implementation of the ItemCatalog class
+
+#include "../include/item_catalog.h"
+#include "../include/world.h"
+
+// Number of items in the world
+int ItemCatalog::size() const {
+    return world->itemCount();
+}
+
+// Find an item by key
+ItemId ItemCatalog::find(std::string_view key) const {
+    return static_cast<ItemId>(world->findItem(key));
+}
+
+// Item record in the world image
+const WorldItemRecord& ItemCatalog::record(ItemId item) const {
+    return world->item(itemIndex(item));
+}
+
+// Item key, as used in commands
+std::string_view ItemCatalog::key(ItemId item) const {
+    return world->text(record(item).key);
+}
+
+// Display name
+std::string_view ItemCatalog::name(ItemId item) const {
+    return world->text(record(item).name);
+}
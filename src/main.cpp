@@ -1,10 +1,13 @@
 // RoboQuest - A text-based adventure game in C++
 // main.cpp - Entry point for the application
 
+#include <cstdlib>
 #include <iostream>
 #include <string>
 #include <limits>
 #include "../include/game.h"
+#include "../include/json_handler.h"
+#include "../include/metrics.h"
 
 // Function to clear the input buffer
 void clearInputBuffer() {
@@ -13,6 +16,11 @@ void clearInputBuffer() {
 }
 
 int main() {
+    // Instrumented builds write their counters on exit if asked to
+    if (const char* metricsPath = std::getenv("ROBOQUEST_METRICS_FILE")) {
+        dumpMetricsAtExit(metricsPath);
+    }
+    
     // Display welcome message
     std::cout << "====================================" << std::endl;
     std::cout << "Welcome to RoboQuest - A Robotics Adventure" << std::endl;
@@ -20,8 +28,17 @@ int main() {
     std::cout << "Version 0.2 - Fallout-Style Dialogue System" << std::endl;
     std::cout << "====================================" << std::endl;
     
-    // Create game instance
+    // Create game instance; the shutdown countdown runs in real time
+    SessionClock clock;
     Game game;
+    game.setClock(&clock);
+    JsonHandler scoreHandler("data/high_scores.rqs");
+    // Carry over scores from the text log used by older versions
+    scoreHandler.importLogIfEmpty("data/high_scores.txt");
+    if (scoreHandler.needsCompaction()) {
+        scoreHandler.compact();
+    }
+    game.setScoreHandler(&scoreHandler);
     
     // Get player name
     std::string playerName;
@@ -58,7 +75,9 @@ int main() {
     }
     
     // Initialize and run the game
-    game.initialize();
+    if (!game.initialize()) {
+        return 1;
+    }
     game.run();
     
     // Game has ended
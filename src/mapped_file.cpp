@@ -0,0 +1,161 @@
+// mapped_file.cpp - Implementation of the MappedFile class
+
+#include "../include/mapped_file.h"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+// Constructor
+MappedFile::MappedFile() :
+    mappedData(nullptr),
+    mappedSize(0)
+#ifdef _WIN32
+    , fileHandle(nullptr),
+    mappingHandle(nullptr)
+#endif
+{
+}
+
+// Destructor
+MappedFile::~MappedFile() {
+    close();
+}
+
+// Move constructor
+MappedFile::MappedFile(MappedFile&& other) noexcept :
+    mappedData(other.mappedData),
+    mappedSize(other.mappedSize)
+#ifdef _WIN32
+    , fileHandle(other.fileHandle),
+    mappingHandle(other.mappingHandle)
+#endif
+{
+    other.mappedData = nullptr;
+    other.mappedSize = 0;
+#ifdef _WIN32
+    other.fileHandle = nullptr;
+    other.mappingHandle = nullptr;
+#endif
+}
+
+// Move assignment
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(mappedData, other.mappedData);
+        std::swap(mappedSize, other.mappedSize);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+// Map a file using the Win32 file mapping API
+bool MappedFile::open(const std::string& path, std::string& error) {
+    close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        error = "Could not open " + path;
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        error = "Could not map empty file " + path;
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        error = "Could not create file mapping for " + path;
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        error = "Could not map " + path;
+        return false;
+    }
+
+    fileHandle = file;
+    mappingHandle = mapping;
+    mappedData = static_cast<const char*>(view);
+    mappedSize = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+// Release the view and handles
+void MappedFile::close() {
+    if (mappedData != nullptr) {
+        UnmapViewOfFile(mappedData);
+        CloseHandle(mappingHandle);
+        CloseHandle(fileHandle);
+    }
+    mappedData = nullptr;
+    mappedSize = 0;
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+}
+
+#else
+
+// Map a file using mmap
+bool MappedFile::open(const std::string& path, std::string& error) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "Could not open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        error = "Could not map empty file " + path;
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps the file referenced
+    if (view == MAP_FAILED) {
+        error = "Could not map " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    mappedData = static_cast<const char*>(view);
+    mappedSize = static_cast<size_t>(info.st_size);
+    return true;
+}
+
+// Unmap the file
+void MappedFile::close() {
+    if (mappedData != nullptr) {
+        munmap(const_cast<char*>(mappedData), mappedSize);
+    }
+    mappedData = nullptr;
+    mappedSize = 0;
+}
+
+#endif
@@ -0,0 +1,212 @@
+// RoboQuest - A text-based adventure game in C++
+// metrics.cpp - Counters, histograms and their text and JSON dumps
+
+#include "../include/metrics.h"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+Metrics allMetrics;
+
+const char* const VERB_NAMES[VERB_COUNT] = {
+    "unknown", "north", "south", "east", "west", "look", "inventory", "take", "use",
+    "help", "quit", "examine_pipeline", "check_version", "fix_build", "yes", "no"
+};
+
+// Histograms other than the per-verb ones, in dump order
+struct NamedHistogram {
+    const char* name;
+    MetricHistogram Metrics::*histogram;
+};
+
+const NamedHistogram OTHER_HISTOGRAMS[] = {
+    {"allocations_per_turn", &Metrics::allocationsPerTurn},
+    {"output_bytes_per_turn", &Metrics::outputBytesPerTurn},
+    {"score_write_ns", &Metrics::scoreWriteLatency},
+    {"score_records_per_write", &Metrics::scoreRecordsPerWrite},
+};
+
+uint64_t bucketLimit(int bucket) {
+    if (bucket == 0) {
+        return 0;
+    }
+    return bucket >= 64 ? UINT64_MAX : (uint64_t(1) << bucket) - 1;
+}
+
+void textRow(std::ostream& out, const std::string& name, const MetricHistogram& histogram) {
+    out << std::left << std::setw(30) << name << std::right
+        << std::setw(12) << histogram.count()
+        << std::setw(12) << std::fixed << std::setprecision(1) << histogram.mean()
+        << std::setw(12) << histogram.percentile(0.5)
+        << std::setw(12) << histogram.percentile(0.9)
+        << std::setw(12) << histogram.percentile(0.99)
+        << std::setw(12) << histogram.max() << "\n";
+}
+
+void jsonHistogram(std::ostream& out, const MetricHistogram& histogram) {
+    out << "{\"count\":" << histogram.count()
+        << ",\"mean\":" << std::fixed << std::setprecision(1) << histogram.mean()
+        << ",\"p50\":" << histogram.percentile(0.5)
+        << ",\"p90\":" << histogram.percentile(0.9)
+        << ",\"p99\":" << histogram.percentile(0.99)
+        << ",\"max\":" << histogram.max() << "}";
+}
+
+std::string& exitDumpPath() {
+    static std::string path;
+    return path;
+}
+
+void dumpAtExit() {
+    std::string error;
+    if (!writeMetricsFile(exitDumpPath(), error)) {
+        std::cerr << "Error: " << error << std::endl;
+    }
+}
+
+} // namespace
+
+void MetricHistogram::record(uint64_t value) {
+    buckets[std::bit_width(value)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen = largest.load(std::memory_order_relaxed);
+    while (value > seen && !largest.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t MetricHistogram::count() const {
+    uint64_t n = 0;
+    for (const auto& bucket : buckets) {
+        n += bucket.load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+double MetricHistogram::mean() const {
+    uint64_t n = count();
+    return n == 0 ? 0.0 : static_cast<double>(valueSum()) / static_cast<double>(n);
+}
+
+uint64_t MetricHistogram::percentile(double fraction) const {
+    uint64_t n = count();
+    if (n == 0) {
+        return 0;
+    }
+    uint64_t wanted = static_cast<uint64_t>(fraction * static_cast<double>(n) + 0.5);
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= wanted && seen > 0) {
+            return std::min(bucketLimit(i), max());
+        }
+    }
+    return max();
+}
+
+void MetricHistogram::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    sum.store(0, std::memory_order_relaxed);
+    largest.store(0, std::memory_order_relaxed);
+}
+
+Metrics& metrics() {
+    return allMetrics;
+}
+
+void resetMetrics() {
+    for (MetricHistogram& histogram : allMetrics.turnLatency) {
+        histogram.reset();
+    }
+    for (const NamedHistogram& named : OTHER_HISTOGRAMS) {
+        (allMetrics.*named.histogram).reset();
+    }
+}
+
+void writeMetricsText(std::ostream& out) {
+    if (!METRICS_ENABLED) {
+        out << "Metrics are not built in; configure with -DROBOQUEST_METRICS=ON\n";
+        return;
+    }
+
+    uint64_t turns = 0;
+    for (const MetricHistogram& histogram : allMetrics.turnLatency) {
+        turns += histogram.count();
+    }
+    std::ios::fmtflags flags = out.flags();
+    out << "turns: " << turns << "\n"
+        << std::left << std::setw(30) << "metric" << std::right
+        << std::setw(12) << "count" << std::setw(12) << "mean" << std::setw(12) << "p50"
+        << std::setw(12) << "p90" << std::setw(12) << "p99" << std::setw(12) << "max" << "\n";
+    for (int verb = 0; verb < VERB_COUNT; verb++) {
+        if (allMetrics.turnLatency[verb].count() > 0) {
+            textRow(out, std::string("turn_ns/") + VERB_NAMES[verb], allMetrics.turnLatency[verb]);
+        }
+    }
+    for (const NamedHistogram& named : OTHER_HISTOGRAMS) {
+        textRow(out, named.name, allMetrics.*named.histogram);
+    }
+    out.flags(flags);
+}
+
+void writeMetricsJson(std::ostream& out) {
+    std::ios::fmtflags flags = out.flags();
+    uint64_t turns = 0;
+    for (const MetricHistogram& histogram : allMetrics.turnLatency) {
+        turns += histogram.count();
+    }
+    out << "{\"enabled\":" << (METRICS_ENABLED ? "true" : "false")
+        << ",\"turns\":" << turns << ",\"turn_ns\":{";
+    bool first = true;
+    for (int verb = 0; verb < VERB_COUNT; verb++) {
+        if (allMetrics.turnLatency[verb].count() == 0) {
+            continue;
+        }
+        out << (first ? "" : ",") << "\"" << VERB_NAMES[verb] << "\":";
+        jsonHistogram(out, allMetrics.turnLatency[verb]);
+        first = false;
+    }
+    out << "}";
+    for (const NamedHistogram& named : OTHER_HISTOGRAMS) {
+        out << ",\"" << named.name << "\":";
+        jsonHistogram(out, allMetrics.*named.histogram);
+    }
+    out << "}\n";
+    out.flags(flags);
+}
+
+bool writeMetricsFile(const std::string& path, std::string& error) {
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (path == "-") {
+        writeMetricsText(std::cerr);
+        return true;
+    }
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        error = "Could not open " + path + " for metrics";
+        return false;
+    }
+    if (json) {
+        writeMetricsJson(file);
+    } else {
+        writeMetricsText(file);
+    }
+    return true;
+}
+
+void dumpMetricsAtExit(const std::string& path) {
+    std::string& target = exitDumpPath();
+    bool registered = !target.empty();
+    target = path;
+    if (!registered) {
+        std::atexit(dumpAtExit);
+    }
+}
@@ -0,0 +1,154 @@
+// RoboQuest - A text-based adventure game in C++
+// option_menus.cpp - Implementation of the OptionMenus class
+
+#include "../include/option_menus.h"
+#include "../include/rule_table.h"
+#include "../include/world.h"
+#include <algorithm>
+
+namespace {
+
+void addOption(OptionMenu& menu, std::string label, std::string action) {
+    menu.labels.push_back(std::move(label));
+    menu.actions.push_back(std::move(action));
+}
+
+// Parse the actions once they are in their final place, as commands keep
+// views into them
+void parseActions(OptionMenu& menu, const World& world) {
+    menu.commands.clear();
+    menu.commands.reserve(menu.actions.size());
+    for (const std::string& action : menu.actions) {
+        menu.commands.push_back(parseCommand(action, world));
+    }
+}
+
+} // namespace
+
+// Constructor
+OptionMenus::OptionMenus() : world(nullptr), rules(nullptr) {
+}
+
+void OptionMenus::build(const World& source, const RuleTable& roomRules) {
+    world = &source;
+    rules = &roomRules;
+    rooms.assign(source.roomCount(), RoomTable());
+    menus.clear();
+
+    // Which items and flags each room's menu depends on
+    for (int room = 0; room < source.roomCount(); room++) {
+        RoomTable& table = rooms[room];
+        ItemSet items;
+        uint32_t flags = 0;
+        for (const Rule& rule : roomRules.inRoom(room)) {
+            for (int i = 0; i < source.itemCount(); i++) {
+                ItemId item = static_cast<ItemId>(i);
+                if ((rule.required.has(item) || rule.forbidden.has(item)) && !items.has(item)) {
+                    items.add(item);
+                    table.items.push_back(item);
+                }
+            }
+            flags |= rule.requiredFlags | rule.forbiddenFlags;
+        }
+        for (uint32_t flag = 1; flag != 0; flag <<= 1) {
+            if (flags & flag) {
+                table.flags.push_back(flag);
+            }
+        }
+    }
+
+    // One menu per combination of those items and flags, the item at
+    // position i of the list standing for bit i of the menu's index in the
+    // table and the flags following the items
+    size_t total = 0;
+    for (RoomTable& table : rooms) {
+        if (table.items.size() + table.flags.size() <= static_cast<size_t>(MAX_TABLE_ITEMS)) {
+            table.first = total;
+            total += size_t(1) << (table.items.size() + table.flags.size());
+        } else {
+            table.first = NO_TABLE;
+        }
+    }
+    menus.resize(total);
+    for (int room = 0; room < source.roomCount(); room++) {
+        const RoomTable& table = rooms[room];
+        if (table.first == NO_TABLE) {
+            continue;
+        }
+        size_t itemBits = table.items.size();
+        for (size_t combination = 0; combination < (size_t(1) << (itemBits + table.flags.size())); combination++) {
+            ItemSet inventory;
+            uint32_t flags = 0;
+            for (size_t bit = 0; bit < itemBits; bit++) {
+                if (combination & (size_t(1) << bit)) {
+                    inventory.add(table.items[bit]);
+                }
+            }
+            for (size_t bit = 0; bit < table.flags.size(); bit++) {
+                if (combination & (size_t(1) << (itemBits + bit))) {
+                    flags |= table.flags[bit];
+                }
+            }
+            compose(room, inventory, flags, menus[table.first + combination]);
+        }
+    }
+}
+
+const OptionMenu& OptionMenus::find(int room, const ItemSet& inventory, uint32_t flags, OptionMenu& scratch) const {
+    const RoomTable& table = rooms[room];
+    if (table.first == NO_TABLE) {
+        compose(room, inventory, flags, scratch);
+        return scratch;
+    }
+    size_t combination = 0;
+    for (size_t bit = 0; bit < table.items.size(); bit++) {
+        combination |= static_cast<size_t>(inventory.has(table.items[bit])) << bit;
+    }
+    for (size_t bit = 0; bit < table.flags.size(); bit++) {
+        combination |= static_cast<size_t>((flags & table.flags[bit]) != 0) << (table.items.size() + bit);
+    }
+    return menus[table.first + combination];
+}
+
+void OptionMenus::compose(int room, const ItemSet& inventory, uint32_t flags, OptionMenu& menu) const {
+    menu.labels.clear();
+    menu.actions.clear();
+
+    // Add movement options based on available paths
+    if (world->neighbor(room, NORTH) != RoomIndex::NO_ROOM) {
+        addOption(menu, "Go north", "north");
+    }
+    if (world->neighbor(room, SOUTH) != RoomIndex::NO_ROOM) {
+        addOption(menu, "Go south", "south");
+    }
+    if (world->neighbor(room, EAST) != RoomIndex::NO_ROOM) {
+        addOption(menu, "Go east", "east");
+    }
+    if (world->neighbor(room, WEST) != RoomIndex::NO_ROOM) {
+        addOption(menu, "Go west", "west");
+    }
+
+    // Add standard options
+    addOption(menu, "Look around", "look");
+    addOption(menu, "Check inventory", "inventory");
+
+    // Interactions the room's rules offer right now, in world order
+    std::vector<const Rule*> offered;
+    for (const Rule& rule : rules->inRoom(room)) {
+        if (rule.applies(inventory, flags)) {
+            offered.push_back(&rule);
+        }
+    }
+    std::sort(offered.begin(), offered.end(), [](const Rule* a, const Rule* b) {
+        return a->order < b->order;
+    });
+    for (const Rule* rule : offered) {
+        addOption(menu, std::string(world->text(rule->record->option)), std::string(world->text(rule->record->command)));
+    }
+
+    // Always add help and quit options
+    addOption(menu, "Help", "help");
+    addOption(menu, "Quit game", "quit");
+
+    parseActions(menu, *world);
+}
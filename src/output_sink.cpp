@@ -0,0 +1,52 @@
+// output_sink.cpp - Output sink implementations
+
+#include "../include/output_sink.h"
+#include <cstdio>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+// Write through stdio so text stays ordered with other std::cout output
+void StdoutSink::write(const char* data, size_t size) {
+    std::fwrite(data, 1, size, stdout);
+    std::fflush(stdout);
+}
+
+#ifndef _WIN32
+// Write everything, retrying after interrupts and short writes
+void DescriptorSink::write(const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return; // peer gone; the session is closed elsewhere
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+#endif
+
+// Append a single character
+TurnBuffer::int_type TurnBuffer::overflow(int_type c) {
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        pending.push_back(traits_type::to_char_type(c));
+    }
+    return traits_type::not_eof(c);
+}
+
+// Append a run of characters
+std::streamsize TurnBuffer::xsputn(const char* data, std::streamsize size) {
+    pending.append(data, static_cast<size_t>(size));
+    return size;
+}
+
+// Hand the turn's text to the sink
+void TurnBuffer::emit() {
+    if (!pending.empty() && sink != nullptr) {
+        sink->write(pending.data(), pending.size());
+    }
+    pending.clear();
+}
@@ -0,0 +1,399 @@
+// RoboQuest - A text-based adventure game in C++
+// replay.cpp - Replay recording, reading and verification
+
+#include "../include/replay.h"
+#include "../include/game.h"
+#include "../include/mapped_file.h"
+#include "../include/name_hash.h"
+#include "../include/session_clock.h"
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <string_view>
+
+namespace {
+
+const size_t WRITE_BUFFER_SIZE = 1 << 16;
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void putSigned(std::string& out, int64_t value) {
+    putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void putFixed32(std::string& out, uint32_t value) {
+    char bytes[4];
+    std::memcpy(bytes, &value, sizeof(bytes));
+    out.append(bytes, sizeof(bytes));
+}
+
+bool hasItem(Verb verb) {
+    return verb == Verb::TAKE || verb == Verb::USE;
+}
+
+// Bounds-checked reader over one block
+class BlockReader {
+private:
+    const unsigned char* pos;
+    const unsigned char* end;
+    bool failed;
+
+public:
+    BlockReader(const char* data, size_t size) :
+        pos(reinterpret_cast<const unsigned char*>(data)),
+        end(reinterpret_cast<const unsigned char*>(data) + size),
+        failed(false) {
+    }
+
+    bool ok() const {
+        return !failed;
+    }
+
+    size_t remaining() const {
+        return static_cast<size_t>(end - pos);
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (pos == end) {
+                break;
+            }
+            unsigned char byte = *pos++;
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        failed = true;
+        return 0;
+    }
+
+    int64_t signedVarint() {
+        uint64_t value = varint();
+        return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+    }
+
+    uint32_t fixed32() {
+        uint32_t value = 0;
+        if (remaining() < sizeof(value)) {
+            failed = true;
+            return 0;
+        }
+        std::memcpy(&value, pos, sizeof(value));
+        pos += sizeof(value);
+        return value;
+    }
+
+    std::string_view bytes(size_t count) {
+        if (remaining() < count) {
+            failed = true;
+            return std::string_view();
+        }
+        std::string_view text(reinterpret_cast<const char*>(pos), count);
+        pos += count;
+        return text;
+    }
+};
+
+bool decodeSession(const char* data, size_t size, ReplaySession& session) {
+    BlockReader in(data, size);
+    session.worldFingerprint = in.fixed32();
+    session.difficulty = static_cast<int>(in.varint());
+    session.flags = static_cast<uint32_t>(in.varint());
+    session.startTime = in.varint();
+    session.playerName.assign(in.bytes(in.varint()));
+    bool realTime = (session.flags & REPLAY_REAL_TIME) != 0;
+
+    session.commands.clear();
+    uint64_t tick = 0;
+    while (in.ok()) {
+        uint64_t code = in.varint();
+        if (code == 0) {
+            break;
+        }
+        if (code > static_cast<uint64_t>(VERB_COUNT)) {
+            return false;
+        }
+        ReplayCommand command;
+        command.verb = static_cast<Verb>(code - 1);
+        command.item = ItemId::NONE;
+        if (hasItem(command.verb)) {
+            command.item = static_cast<ItemId>(static_cast<int64_t>(in.varint()) - 1);
+        }
+        if (realTime) {
+            tick += in.varint();
+        }
+        command.tick = tick;
+        session.commands.push_back(command);
+    }
+
+    session.end = static_cast<ReplayEnd>(in.varint());
+    session.endTick = realTime ? tick + in.varint() : 0;
+    session.score = static_cast<int>(in.signedVarint());
+    session.timeRemaining = static_cast<int>(in.signedVarint());
+    session.stateHash = in.fixed32();
+    return in.ok() && in.remaining() == 0 && session.end <= ReplayEnd::ABANDONED;
+}
+
+// Length of the replay file at path up to the end of its last complete
+// block, or 0 if it holds no header yet. Fails on a file that is not a
+// replay file.
+bool intactLength(const std::string& path, uint64_t& length, std::string& error) {
+    length = 0;
+    std::error_code code;
+    uint64_t size = std::filesystem::file_size(path, code);
+    if (code || size < sizeof(ReplayFileHeader)) {
+        return true; // new, or torn inside the header
+    }
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    ReplayFileHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION) {
+        error = path + " is not a replay file of this version";
+        return false;
+    }
+
+    BlockReader in(file.data() + sizeof(header), file.size() - sizeof(header));
+    length = sizeof(header);
+    while (in.remaining() > 0) {
+        uint64_t blockLength = in.varint();
+        in.bytes(static_cast<size_t>(blockLength));
+        if (!in.ok()) {
+            break;
+        }
+        length = file.size() - in.remaining();
+    }
+    return true;
+}
+
+} // namespace
+
+uint32_t replayStateHash(const GameState& state) {
+    return nameHash(std::string_view(reinterpret_cast<const char*>(&state), sizeof(state)), REPLAY_MAGIC);
+}
+
+// Constructor
+ReplayWriter::ReplayWriter() : file(nullptr) {
+}
+
+// Destructor
+ReplayWriter::~ReplayWriter() {
+    close();
+}
+
+bool ReplayWriter::open(const std::string& path, std::string& error) {
+    close();
+
+    // Cut off a block torn by a crash, or the next session would be read
+    // as part of it
+    uint64_t length = 0;
+    if (!intactLength(path, length, error)) {
+        return false;
+    }
+    std::error_code code;
+    if (std::filesystem::exists(path, code) && std::filesystem::file_size(path, code) != length) {
+        std::filesystem::resize_file(path, length, code);
+        if (code) {
+            error = "Could not truncate a torn session in " + path;
+            return false;
+        }
+    }
+
+    file = std::fopen(path.c_str(), "ab");
+    if (file == nullptr) {
+        error = "Could not open " + path + " for recording";
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    if (std::ftell(file) == 0) {
+        ReplayFileHeader header = {REPLAY_MAGIC, REPLAY_VERSION};
+        std::fwrite(&header, sizeof(header), 1, file);
+    }
+    buffer.reserve(WRITE_BUFFER_SIZE);
+    return true;
+}
+
+void ReplayWriter::close() {
+    if (file != nullptr) {
+        flush();
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+void ReplayWriter::write(const std::string& block) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == nullptr) {
+        return;
+    }
+    if (buffer.size() + block.size() > WRITE_BUFFER_SIZE && !buffer.empty()) {
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+    }
+    buffer.insert(buffer.end(), block.begin(), block.end());
+}
+
+void ReplayWriter::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (file == nullptr) {
+        return;
+    }
+    if (!buffer.empty()) {
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+        buffer.clear();
+    }
+    std::fflush(file);
+}
+
+// Constructor
+ReplayRecorder::ReplayRecorder(ReplayWriter& target) :
+    writer(target),
+    active(false),
+    realTime(false),
+    lastTick(0),
+    commands(0) {
+}
+
+void ReplayRecorder::begin(uint32_t worldFingerprint, int difficulty, const std::string& playerName,
+                           bool onClock, uint64_t tick) {
+    block.clear();
+    putFixed32(block, worldFingerprint);
+    putVarint(block, static_cast<uint64_t>(difficulty));
+    putVarint(block, onClock ? REPLAY_REAL_TIME : 0);
+    putVarint(block, static_cast<uint64_t>(std::time(nullptr)));
+    putVarint(block, playerName.size());
+    block.append(playerName);
+    active = true;
+    realTime = onClock;
+    lastTick = tick;
+    commands = 0;
+}
+
+void ReplayRecorder::command(const Command& command, uint64_t tick) {
+    if (!active) {
+        return;
+    }
+    putVarint(block, static_cast<uint64_t>(command.verb) + 1);
+    if (hasItem(command.verb)) {
+        putVarint(block, static_cast<uint64_t>(itemIndex(command.item) + 1));
+    }
+    if (realTime) {
+        putVarint(block, tick - lastTick);
+        lastTick = tick;
+    }
+    commands++;
+}
+
+void ReplayRecorder::finish(ReplayEnd end, uint64_t tick, const GameState& state) {
+    if (!active) {
+        return;
+    }
+    active = false;
+    if (end == ReplayEnd::ABANDONED && commands == 0) {
+        return;
+    }
+    putVarint(block, 0);
+    putVarint(block, static_cast<uint64_t>(end));
+    if (realTime) {
+        putVarint(block, tick - lastTick);
+    }
+    putSigned(block, state.score);
+    putSigned(block, state.timeRemaining);
+    putFixed32(block, replayStateHash(state));
+
+    // Length first, so readers can skip or stop at a torn block
+    std::string framed;
+    framed.reserve(block.size() + 5);
+    putVarint(framed, block.size());
+    framed.append(block);
+    writer.write(framed);
+}
+
+bool readReplays(const std::string& path, std::vector<ReplaySession>& sessions, std::string& error) {
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    ReplayFileHeader header;
+    if (file.size() < sizeof(header)) {
+        error = path + " is not a replay file";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != REPLAY_MAGIC) {
+        error = path + " is not a replay file";
+        return false;
+    }
+    if (header.version != REPLAY_VERSION) {
+        error = "replay version " + std::to_string(header.version) + " is not supported";
+        return false;
+    }
+
+    BlockReader in(file.data() + sizeof(header), file.size() - sizeof(header));
+    while (in.remaining() > 0) {
+        uint64_t length = in.varint();
+        std::string_view block = in.bytes(static_cast<size_t>(length));
+        if (!in.ok()) {
+            break; // torn last block
+        }
+        ReplaySession session;
+        if (!decodeSession(block.data(), block.size(), session)) {
+            error = "damaged session " + std::to_string(sessions.size()) + " in " + path;
+            return false;
+        }
+        sessions.push_back(std::move(session));
+    }
+    return true;
+}
+
+ReplayResult replaySession(Game& game, SessionClock& clock, const ReplaySession& session) {
+    bool realTime = (session.flags & REPLAY_REAL_TIME) != 0;
+    uint64_t start = clock.tick();
+    clock.setTick(start);
+    clock.advance(); // catch the wheel up while no countdown is running
+
+    game.setDifficulty(static_cast<Difficulty>(session.difficulty));
+    game.setPlayerName(session.playerName);
+    game.setClock(realTime ? &clock : nullptr);
+    game.reset();
+
+    Command command;
+    for (const ReplayCommand& recorded : session.commands) {
+        if (realTime) {
+            clock.setTick(start + recorded.tick);
+        }
+        command.verb = recorded.verb;
+        command.item = recorded.item;
+        command.argument = std::string_view();
+        game.step(command);
+    }
+
+    // End the way the recording did
+    if (session.end == ReplayEnd::FINISHED && realTime) {
+        clock.setTick(start + session.endTick);
+        clock.advance(); // a countdown that ran out fires here
+    } else if (session.end == ReplayEnd::QUIT) {
+        game.quit();
+    }
+    game.flushOutput();
+
+    GameState state = game.snapshot();
+    ReplayResult result;
+    result.sameWorld = game.worldFingerprint() == session.worldFingerprint;
+    result.score = state.score;
+    result.stateHash = replayStateHash(state);
+    result.matched = result.sameWorld && result.score == session.score &&
+                     result.stateHash == session.stateHash;
+    game.setClock(nullptr);
+    return result;
+}
@@ -0,0 +1,150 @@
+// room_index.cpp - Implementation of the RoomIndex class
+
+#include "../include/room_index.h"
+#include <algorithm>
+#include <limits>
+
+// Constructor
+RoomIndex::RoomIndex() :
+    hashed(false),
+    minX(0),
+    minY(0),
+    width(0),
+    height(0) {
+}
+
+// Add a room to the index
+int RoomIndex::addRoom(int x, int y, const std::string& description) {
+    Room room;
+    room.x = x;
+    room.y = y;
+    room.description = description;
+    for (int d = 0; d < DIRECTION_COUNT; d++) {
+        room.neighbors[d] = NO_ROOM;
+    }
+    rooms.push_back(room);
+    return static_cast<int>(rooms.size()) - 1;
+}
+
+// Build the lookup grid and resolve every room's neighbors
+void RoomIndex::build() {
+    grid.clear();
+    hashed = false;
+    width = 0;
+    height = 0;
+    if (rooms.empty()) {
+        return;
+    }
+
+    int maxX = rooms[0].x;
+    int maxY = rooms[0].y;
+    minX = rooms[0].x;
+    minY = rooms[0].y;
+    for (const auto& room : rooms) {
+        minX = std::min(minX, room.x);
+        minY = std::min(minY, room.y);
+        maxX = std::max(maxX, room.x);
+        maxY = std::max(maxY, room.y);
+    }
+
+    // The bounding box may span the whole int range in either direction
+    int64_t spanX = static_cast<int64_t>(maxX) - minX + 1;
+    int64_t spanY = static_cast<int64_t>(maxY) - minY + 1;
+    int64_t limit = std::min(MAX_GRID_CELLS, GRID_CELLS_PER_ROOM * static_cast<int64_t>(rooms.size()));
+    hashed = spanX > limit || spanY > limit || spanX * spanY > limit;
+    if (hashed) {
+        size_t slots = 1;
+        while (slots < rooms.size() * 2) {
+            slots <<= 1;
+        }
+        grid.assign(slots, NO_ROOM);
+    } else {
+        width = static_cast<int>(spanX);
+        height = static_cast<int>(spanY);
+        grid.assign(static_cast<size_t>(width) * height, NO_ROOM);
+    }
+
+    for (size_t i = 0; i < rooms.size(); i++) {
+        grid[slotOf(rooms[i].x, rooms[i].y)] = static_cast<int>(i);
+    }
+
+    for (auto& room : rooms) {
+        for (int d = 0; d < DIRECTION_COUNT; d++) {
+            Direction direction = static_cast<Direction>(d);
+            room.neighbors[d] = locate(static_cast<int64_t>(room.x) + directionDX(direction),
+                                       static_cast<int64_t>(room.y) + directionDY(direction));
+        }
+    }
+}
+
+// Remove all rooms
+void RoomIndex::clear() {
+    rooms.clear();
+    grid.clear();
+    hashed = false;
+    minX = 0;
+    minY = 0;
+    width = 0;
+    height = 0;
+}
+
+// Find the room at the given coordinates
+int RoomIndex::find(int x, int y) const {
+    return locate(x, y);
+}
+
+// Room at a coordinate that may lie outside the int range, or NO_ROOM
+int RoomIndex::locate(int64_t x, int64_t y) const {
+    if (hashed) {
+        if (x < std::numeric_limits<int>::min() || x > std::numeric_limits<int>::max() ||
+            y < std::numeric_limits<int>::min() || y > std::numeric_limits<int>::max()) {
+            return NO_ROOM;
+        }
+        return grid[slotOf(static_cast<int>(x), static_cast<int>(y))];
+    }
+    int64_t col = x - minX;
+    int64_t row = y - minY;
+    if (col < 0 || col >= width || row < 0 || row >= height) {
+        return NO_ROOM;
+    }
+    return grid[slotOf(static_cast<int>(x), static_cast<int>(y))];
+}
+
+// The grid cell of a coordinate inside the bounding box. When hashed, the
+// slot holding the room at that coordinate, or the empty slot ending its
+// probe; there are more slots than rooms, so one is always empty.
+size_t RoomIndex::slotOf(int x, int y) const {
+    if (!hashed) {
+        return static_cast<size_t>(y - minY) * width + static_cast<size_t>(x - minX);
+    }
+    size_t mask = grid.size() - 1;
+    size_t slot = roomCellHash(x, y) & mask;
+    while (grid[slot] != NO_ROOM && (rooms[grid[slot]].x != x || rooms[grid[slot]].y != y)) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+// Horizontal offset of a direction
+int directionDX(Direction direction) {
+    switch (direction) {
+        case EAST:
+            return 1;
+        case WEST:
+            return -1;
+        default:
+            return 0;
+    }
+}
+
+// Vertical offset of a direction
+int directionDY(Direction direction) {
+    switch (direction) {
+        case NORTH:
+            return 1;
+        case SOUTH:
+            return -1;
+        default:
+            return 0;
+    }
+}
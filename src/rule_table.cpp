@@ -0,0 +1,104 @@
+// RoboQuest - A text-based adventure game in C++
+// rule_table.cpp - Implementation of the RuleTable class
+
+#include "../include/rule_table.h"
+#include "../include/game_state.h"
+#include "../include/world.h"
+#include <algorithm>
+
+static_assert(WORLD_ITEM_LIMIT == MAX_ITEMS, "item masks in the image must cover every item");
+static_assert(FLAG_EXIT_UNLOCKED == WORLD_FLAG_EXIT_UNLOCKED << WORLD_FLAG_SHIFT, "the exit lock must map to its flag");
+static_assert(WORLD_FLAG_SHIFT + WORLD_FLAG_COUNT <= 32, "world flags must fit in GameState::flags");
+
+namespace {
+
+ItemSet itemMask(const uint64_t* words) {
+    ItemSet items;
+    for (int i = 0; i < MAX_ITEMS; i++) {
+        if ((words[i / 64] >> (i % 64)) & 1u) {
+            items.add(static_cast<ItemId>(i));
+        }
+    }
+    return items;
+}
+
+} // namespace
+
+// Constructor
+RuleTable::RuleTable() : verbStarts(VERB_COUNT + 1, 0) {
+}
+
+bool RuleTable::handles(Verb verb) {
+    switch (verb) {
+        case Verb::TAKE:
+        case Verb::USE:
+        case Verb::EXAMINE_PIPELINE:
+        case Verb::CHECK_VERSION:
+        case Verb::FIX_BUILD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool RuleTable::build(const World& world, std::string& error) {
+    rules.clear();
+    verbStarts.assign(VERB_COUNT + 1, 0);
+    roomTables.assign(world.roomCount(), NO_RULES);
+
+    // Resolve every rule, remembering its room for the sort below
+    std::vector<std::pair<int, Rule>> resolved;
+    resolved.reserve(world.ruleCount());
+    for (int i = 0; i < world.ruleCount(); i++) {
+        const WorldRuleRecord& record = world.rule(i);
+        Command command = parseCommand(world.text(record.command), world);
+        bool needsItem = command.verb == Verb::TAKE || command.verb == Verb::USE;
+        if (!handles(command.verb) || (needsItem && command.item == ItemId::NONE)) {
+            error = "rule '" + std::string(world.text(record.command)) + "' is not a command rules can handle";
+            return false;
+        }
+        if (record.room < 0 || record.room >= world.roomCount()) {
+            error = "rule '" + std::string(world.text(record.command)) + "' is in no room";
+            return false;
+        }
+
+        Rule rule;
+        rule.verb = command.verb;
+        rule.item = command.item;
+        rule.order = i;
+        rule.required = itemMask(record.requiredItems);
+        rule.forbidden = itemMask(record.forbiddenItems);
+        rule.given = itemMask(record.givenItems);
+        rule.taken = itemMask(record.takenItems);
+        rule.requiredFlags = record.requiredFlags << WORLD_FLAG_SHIFT;
+        rule.forbiddenFlags = record.forbiddenFlags << WORLD_FLAG_SHIFT;
+        rule.setFlags = record.setFlags << WORLD_FLAG_SHIFT;
+        rule.clearedFlags = record.clearedFlags << WORLD_FLAG_SHIFT;
+        rule.score = record.score;
+        rule.timeBonus = record.timeBonus;
+        rule.effects = record.effects;
+        rule.script = record.script;
+        rule.record = &record;
+        resolved.emplace_back(record.room, rule);
+    }
+    std::stable_sort(resolved.begin(), resolved.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first < b.first : a.second.verb < b.second.verb;
+    });
+
+    // One table of verb offsets for each room that has rules
+    rules.reserve(resolved.size());
+    for (size_t i = 0; i < resolved.size();) {
+        int room = resolved[i].first;
+        roomTables[room] = static_cast<uint32_t>(verbStarts.size() / (VERB_COUNT + 1));
+        verbStarts.resize(verbStarts.size() + VERB_COUNT + 1);
+        uint32_t* starts = &verbStarts[verbStarts.size() - (VERB_COUNT + 1)];
+        for (int verb = 0; verb <= VERB_COUNT; verb++) {
+            while (i < resolved.size() && resolved[i].first == room &&
+                   static_cast<int>(resolved[i].second.verb) < verb) {
+                rules.push_back(resolved[i++].second);
+            }
+            starts[verb] = static_cast<uint32_t>(rules.size());
+        }
+    }
+    return true;
+}
@@ -0,0 +1,956 @@
+// RoboQuest - A text-based adventure game in C++
+// score_store.cpp - Implementation of the ScoreStore class
+
+#include "../include/score_store.h"
+#include "../include/metrics.h"
+#include "../include/name_hash.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <cstddef>
+#include <random>
+#include <string_view>
+#include <system_error>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace {
+
+#ifdef _WIN32
+
+const ScoreFileHandle NO_FILE = INVALID_HANDLE_VALUE;
+
+ScoreFileHandle openLockFile(const std::string& path) {
+    return CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+
+ScoreFileHandle openForAppend(const std::string& path) {
+    return CreateFileA(path.c_str(), GENERIC_WRITE,
+                       FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                       nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+}
+
+void closeFile(ScoreFileHandle file) {
+    if (file != NO_FILE) CloseHandle(file);
+}
+
+bool lockFile(ScoreFileHandle file) {
+    OVERLAPPED overlapped = {};
+    return LockFileEx(file, LOCKFILE_EXCLUSIVE_LOCK, 0, 1, 0, &overlapped) != 0;
+}
+
+void unlockFile(ScoreFileHandle file) {
+    OVERLAPPED overlapped = {};
+    UnlockFileEx(file, 0, 1, 0, &overlapped);
+}
+
+bool fileSize(ScoreFileHandle file, uint64_t& size) {
+    LARGE_INTEGER value;
+    if (!GetFileSizeEx(file, &value)) return false;
+    size = static_cast<uint64_t>(value.QuadPart);
+    return true;
+}
+
+// Cut the file to size and leave the write position there
+bool truncateFile(ScoreFileHandle file, uint64_t size) {
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(size);
+    return SetFilePointerEx(file, position, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+}
+
+// Write at the end of the file; callers hold the store lock
+bool writeFully(ScoreFileHandle file, const void* data, size_t size) {
+    LARGE_INTEGER zero = {};
+    if (!SetFilePointerEx(file, zero, nullptr, FILE_END)) return false;
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        DWORD written = 0;
+        DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        if (!WriteFile(file, bytes, chunk, &written, nullptr)) return false;
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+// Windows cannot replace a file that is open, so an open handle always
+// refers to the file at its path
+bool pathIdentity(const std::string& path, uint64_t& id, uint64_t& size) {
+    std::error_code code;
+    size = std::filesystem::file_size(path, code);
+    id = 0;
+    return !code;
+}
+
+bool stillAtPath(ScoreFileHandle, const std::string&) {
+    return true;
+}
+
+bool syncFile(ScoreFileHandle file) {
+    return FlushFileBuffers(file) != 0;
+}
+
+bool syncStream(std::FILE* file) {
+    return std::fflush(file) == 0 && _commit(_fileno(file)) == 0;
+}
+
+// NTFS journals renames itself; directories cannot be flushed
+bool syncDirectory(const std::string&) {
+    return true;
+}
+
+#else
+
+const ScoreFileHandle NO_FILE = -1;
+
+ScoreFileHandle openLockFile(const std::string& path) {
+    return ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+}
+
+ScoreFileHandle openForAppend(const std::string& path) {
+    return ::open(path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+}
+
+void closeFile(ScoreFileHandle file) {
+    if (file != NO_FILE) ::close(file);
+}
+
+bool lockFile(ScoreFileHandle file) {
+    while (flock(file, LOCK_EX) != 0) {
+        if (errno != EINTR) return false;
+    }
+    return true;
+}
+
+void unlockFile(ScoreFileHandle file) {
+    flock(file, LOCK_UN);
+}
+
+bool fileSize(ScoreFileHandle file, uint64_t& size) {
+    struct stat info;
+    if (fstat(file, &info) != 0) return false;
+    size = static_cast<uint64_t>(info.st_size);
+    return true;
+}
+
+bool truncateFile(ScoreFileHandle file, uint64_t size) {
+    return ftruncate(file, static_cast<off_t>(size)) == 0;
+}
+
+// O_APPEND places each write at the current end of the file
+bool writeFully(ScoreFileHandle file, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(file, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool pathIdentity(const std::string& path, uint64_t& id, uint64_t& size) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+    id = static_cast<uint64_t>(info.st_ino) ^ (static_cast<uint64_t>(info.st_dev) << 48);
+    size = static_cast<uint64_t>(info.st_size);
+    return true;
+}
+
+// False once the file has been replaced at its path, e.g. by a rebuild
+bool stillAtPath(ScoreFileHandle file, const std::string& path) {
+    struct stat opened;
+    struct stat current;
+    return fstat(file, &opened) == 0 && stat(path.c_str(), &current) == 0 &&
+           opened.st_ino == current.st_ino && opened.st_dev == current.st_dev;
+}
+
+bool syncFile(ScoreFileHandle file) {
+#ifdef __APPLE__
+    return fcntl(file, F_FULLFSYNC) == 0 || fsync(file) == 0;
+#else
+    return fdatasync(file) == 0;
+#endif
+}
+
+bool syncStream(std::FILE* file) {
+    return std::fflush(file) == 0 && fsync(fileno(file)) == 0;
+}
+
+// Make a rename or create in the directory of path durable
+bool syncDirectory(const std::string& path) {
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    int fd = ::open(directory.empty() ? "." : directory.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool synced = fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+#endif
+
+// Holds the cross-process store lock for one scope
+class StoreLock {
+private:
+    ScoreFileHandle file;
+    bool locked;
+
+public:
+    explicit StoreLock(ScoreFileHandle lockFileHandle) :
+        file(lockFileHandle),
+        locked(lockFile(lockFileHandle)) {
+    }
+
+    ~StoreLock() {
+        if (locked) unlockFile(file);
+    }
+
+    bool held() const {
+        return locked;
+    }
+};
+
+const char* const DIFFICULTY_NAMES[SCORE_DIFFICULTY_COUNT] = {"Easy", "Normal", "Hard"};
+const uint32_t CHECKSUM_SEED = 0x52515353;
+
+uint64_t newStoreId() {
+    std::random_device device;
+    uint64_t id = (static_cast<uint64_t>(device()) << 32) ^ device();
+    return id ^ static_cast<uint64_t>(std::chrono::system_clock::now().time_since_epoch().count());
+}
+
+bool writeAll(std::FILE* file, const void* data, size_t size) {
+    return size == 0 || std::fwrite(data, 1, size, file) == size;
+}
+
+// Replace target with source; rename does not overwrite on Windows
+bool replaceFile(const std::string& source, const std::string& target) {
+#ifdef _WIN32
+    std::remove(target.c_str());
+#endif
+    return std::rename(source.c_str(), target.c_str()) == 0;
+}
+
+// Insert a record number into a list ranked by score, keeping at most
+// count entries. Records are offered in append order, so equal scores
+// stay in append order.
+void insertRanked(const ScoreStore& store, std::vector<uint32_t>& ranked,
+                  uint32_t number, size_t count) {
+    int32_t score = store.record(number).score;
+    if (ranked.size() >= count && score <= store.record(ranked.back()).score) {
+        return;
+    }
+    size_t position = ranked.size();
+    while (position > 0 && store.record(ranked[position - 1]).score < score) {
+        position--;
+    }
+    ranked.insert(ranked.begin() + position, number);
+    if (ranked.size() > count) {
+        ranked.pop_back();
+    }
+}
+
+} // namespace
+
+const char* scoreDifficultyName(ScoreDifficulty difficulty) {
+    return difficulty < SCORE_DIFFICULTY_COUNT ? DIFFICULTY_NAMES[difficulty] : "Unknown";
+}
+
+bool parseScoreDifficulty(const std::string& name, ScoreDifficulty& difficulty) {
+    for (int i = 0; i < SCORE_DIFFICULTY_COUNT; i++) {
+        if (name == DIFFICULTY_NAMES[i]) {
+            difficulty = static_cast<ScoreDifficulty>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+ScoreRecord makeScoreRecord(const std::string& playerName, int score,
+                            ScoreDifficulty difficulty, int64_t timestamp) {
+    ScoreRecord record;
+    std::memset(&record, 0, sizeof(record));
+    std::memcpy(record.playerName, playerName.data(),
+                std::min(playerName.size(), SCORE_NAME_LENGTH - 1));
+    record.score = score;
+    record.difficulty = difficulty;
+    record.timestamp = timestamp;
+    record.checksum = scoreRecordChecksum(record);
+    return record;
+}
+
+std::string scoreRecordName(const ScoreRecord& record) {
+    return std::string(record.playerName, strnlen(record.playerName, SCORE_NAME_LENGTH));
+}
+
+uint32_t scoreRecordChecksum(const ScoreRecord& record) {
+    return nameHash(std::string_view(reinterpret_cast<const char*>(&record),
+                                     offsetof(ScoreRecord, checksum)), CHECKSUM_SEED);
+}
+
+bool scoreRecordValid(const ScoreRecord& record) {
+    return record.checksum == scoreRecordChecksum(record);
+}
+
+// Constructor
+ScoreStore::ScoreStore() :
+    header(nullptr),
+    index(nullptr),
+    records(0),
+    mappedId(0),
+    mappedSize(0),
+    lockHandle(NO_FILE),
+    appendHandle(NO_FILE),
+    leaderActive(false),
+    durability(ScoreDurability::NONE),
+    syncInterval(100),
+    dirty(false),
+    stopping(false),
+    dropped(0) {
+}
+
+// Destructor
+ScoreStore::~ScoreStore() {
+    close();
+}
+
+// Open or create the store
+bool ScoreStore::open(const std::string& path, std::string& error) {
+    close();
+    storePath = path;
+
+    lockHandle = openLockFile(path + ".lock");
+    if (lockHandle == NO_FILE) {
+        error = "Could not open " + path + ".lock";
+        return false;
+    }
+    if (!create(error)) {
+        close();
+        return false;
+    }
+
+    appendHandle = openForAppend(path);
+    if (appendHandle == NO_FILE) {
+        error = "Could not open " + path + " for writing";
+        close();
+        return false;
+    }
+    if (!recover(error)) {
+        close();
+        return false;
+    }
+    if (durability == ScoreDurability::BATCHED) {
+        startSyncThread();
+    }
+    return true;
+}
+
+// Write an empty store if none exists. Done under the store lock so two
+// processes starting together cannot each create one.
+bool ScoreStore::create(std::string& error) {
+    StoreLock lock(lockHandle);
+    if (!lock.held()) {
+        error = "Could not lock " + storePath;
+        return false;
+    }
+
+    std::error_code code;
+    if (std::filesystem::exists(storePath, code)) {
+        return true;
+    }
+
+    std::string temporary = storePath + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        error = "Could not create " + storePath;
+        return false;
+    }
+    ScoreStoreHeader fresh;
+    std::memset(&fresh, 0, sizeof(fresh));
+    fresh.magic = SCORE_STORE_MAGIC;
+    fresh.version = SCORE_STORE_VERSION;
+    fresh.headerSize = sizeof(ScoreStoreHeader);
+    fresh.recordSize = sizeof(ScoreRecord);
+    fresh.storeId = newStoreId();
+    bool written = writeAll(file, &fresh, sizeof(fresh)) && syncStream(file);
+    written = std::fclose(file) == 0 && written;
+    if (!written || !replaceFile(temporary, storePath) || !syncDirectory(storePath)) {
+        error = "Could not create " + storePath;
+        return false;
+    }
+    return true;
+}
+
+// Map the store and cut off the damaged records at its end, which is where
+// a crash during an unsynced write leaves them. A damaged record followed
+// by intact ones stays, for queries to skip, so no intact score is lost.
+// Records the index covers were synced before it was written, so only the
+// ones after them are checked. Runs under the store lock so no live writer
+// is cut off.
+bool ScoreStore::recover(std::string& error) {
+    StoreLock lock(lockHandle);
+    if (!lock.held()) {
+        error = "Could not lock " + storePath;
+        return false;
+    }
+    if (!mapStore(error)) {
+        return false;
+    }
+    mapIndex();
+
+    uint32_t checked = index != nullptr ? index->indexedRecords : 0;
+    uint32_t intact = records;
+    const ScoreRecord* data = recordData();
+    while (intact > checked && !scoreRecordValid(data[intact - 1])) {
+        intact--;
+    }
+    uint64_t keep = sizeof(ScoreStoreHeader) + static_cast<uint64_t>(intact) * sizeof(ScoreRecord);
+    if (keep == mappedSize) {
+        return true;
+    }
+
+    dropped = records - intact;
+    storeFile.close(); // Windows cannot resize a mapped file
+    header = nullptr;
+    if (!truncateFile(appendHandle, keep) || !syncFile(appendHandle)) {
+        error = "Could not remove damaged records from " + storePath;
+        return false;
+    }
+    return mapStore(error);
+}
+
+// Sync anything still pending, then unmap the store and its index and
+// release the files
+void ScoreStore::close() {
+    stopSyncThread();
+    if (appendHandle != NO_FILE && durability != ScoreDurability::NONE) {
+        sync();
+    }
+    storeFile.close();
+    indexFile.close();
+    closeFile(appendHandle);
+    closeFile(lockHandle);
+    appendHandle = NO_FILE;
+    lockHandle = NO_FILE;
+    header = nullptr;
+    index = nullptr;
+    records = 0;
+    mappedId = 0;
+    mappedSize = 0;
+    dirty = false;
+}
+
+// Change when appends reach the disk
+void ScoreStore::setDurability(ScoreDurability mode, int intervalMilliseconds) {
+    stopSyncThread();
+    {
+        std::lock_guard<std::mutex> lock(commitMutex);
+        durability = mode;
+        syncInterval = std::max(1, intervalMilliseconds);
+    }
+    if (mode == ScoreDurability::BATCHED && appendHandle != NO_FILE) {
+        startSyncThread();
+    }
+}
+
+bool ScoreStore::sync() {
+    std::unique_lock<std::mutex> lock(commitMutex);
+    return syncAppended(lock);
+}
+
+// Sync written records. Takes the leader role so no batch is written and
+// the append handle is not swapped while the sync runs; appends arriving
+// meanwhile queue up and go out together afterwards.
+bool ScoreStore::syncAppended(std::unique_lock<std::mutex>& lock) {
+    while (leaderActive) {
+        commitDone.wait(lock);
+    }
+    if (!dirty || appendHandle == NO_FILE) {
+        return true;
+    }
+
+    leaderActive = true;
+    dirty = false;
+    lock.unlock();
+    bool synced = syncFile(appendHandle);
+    lock.lock();
+
+    dirty = dirty || !synced;
+    leaderActive = false;
+    commitDone.notify_all();
+    return synced;
+}
+
+// Background loop for BATCHED durability
+void ScoreStore::syncLoop() {
+    std::unique_lock<std::mutex> lock(commitMutex);
+    while (!stopping) {
+        syncWake.wait_for(lock, std::chrono::milliseconds(syncInterval));
+        syncAppended(lock);
+    }
+}
+
+void ScoreStore::startSyncThread() {
+    stopping = false;
+    syncThread = std::thread(&ScoreStore::syncLoop, this);
+}
+
+void ScoreStore::stopSyncThread() {
+    if (!syncThread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(commitMutex);
+        stopping = true;
+    }
+    syncWake.notify_all();
+    syncThread.join();
+}
+
+// Map the record file and validate its header
+bool ScoreStore::mapStore(std::string& error) {
+    header = nullptr;
+    records = 0;
+    if (!pathIdentity(storePath, mappedId, mappedSize) || !storeFile.open(storePath, error)) {
+        error = error.empty() ? "Could not open " + storePath : error;
+        return false;
+    }
+
+    const ScoreStoreHeader* mapped = reinterpret_cast<const ScoreStoreHeader*>(storeFile.data());
+    if (storeFile.size() < sizeof(ScoreStoreHeader) ||
+        mapped->magic != SCORE_STORE_MAGIC ||
+        mapped->version != SCORE_STORE_VERSION ||
+        mapped->headerSize != sizeof(ScoreStoreHeader) ||
+        mapped->recordSize != sizeof(ScoreRecord)) {
+        storeFile.close();
+        error = storePath + " is not a score store of this version";
+        return false;
+    }
+
+    header = mapped;
+    // A partial record at the end is ignored; the next append drops it
+    records = static_cast<uint32_t>((storeFile.size() - sizeof(ScoreStoreHeader)) / sizeof(ScoreRecord));
+    return true;
+}
+
+// Map the index if it matches this store; otherwise queries scan
+void ScoreStore::mapIndex() {
+    index = nullptr;
+    std::string ignored;
+    if (!indexFile.open(indexPath(), ignored)) {
+        return;
+    }
+
+    size_t size = indexFile.size();
+    const ScoreIndexHeader* mapped = reinterpret_cast<const ScoreIndexHeader*>(indexFile.data());
+    bool valid = size >= sizeof(ScoreIndexHeader) &&
+                 mapped->magic == SCORE_INDEX_MAGIC &&
+                 mapped->version == SCORE_INDEX_VERSION &&
+                 mapped->storeId == header->storeId &&
+                 mapped->indexedRecords <= records;
+
+    auto listFits = [size](uint32_t offset, uint32_t count) {
+        return offset % sizeof(uint32_t) == 0 &&
+               offset <= size &&
+               count <= (size - offset) / sizeof(uint32_t);
+    };
+    uint64_t scored = 0;
+    for (int i = 0; valid && i < SCORE_DIFFICULTY_COUNT; i++) {
+        valid = listFits(mapped->byScoreOffset[i], mapped->byScoreCount[i]);
+        scored += mapped->byScoreCount[i];
+    }
+    valid = valid && scored <= mapped->byDateCount && mapped->byDateCount <= mapped->indexedRecords &&
+            listFits(mapped->byDateOffset, mapped->byDateCount);
+
+    if (!valid) {
+        indexFile.close();
+        return;
+    }
+    index = mapped;
+}
+
+const uint32_t* ScoreStore::indexList(uint32_t offset) const {
+    return reinterpret_cast<const uint32_t*>(indexFile.data() + offset);
+}
+
+const ScoreRecord* ScoreStore::recordData() const {
+    return reinterpret_cast<const ScoreRecord*>(storeFile.data() + sizeof(ScoreStoreHeader));
+}
+
+uint32_t ScoreStore::unindexedCount() const {
+    return records - (index != nullptr ? index->indexedRecords : 0);
+}
+
+// Append a single record
+bool ScoreStore::append(const ScoreRecord& record, std::string& error) {
+    return appendAll(std::vector<ScoreRecord>(1, record), error);
+}
+
+// Queue the records and wait until they are written. Whichever caller
+// finds no write in progress becomes the leader: it takes every queued
+// record, writes them under the store lock, and wakes the callers whose
+// records it wrote. Records queued meanwhile go out in the next batch.
+bool ScoreStore::appendAll(const std::vector<ScoreRecord>& batch, std::string& error) {
+    if (batch.empty()) {
+        return true;
+    }
+
+    ScoreWriteProbe probe;
+    int status = 0;
+    std::unique_lock<std::mutex> lock(commitMutex);
+    if (appendHandle == NO_FILE) {
+        error = "Score store is not open";
+        return false;
+    }
+    pendingRecords.insert(pendingRecords.end(), batch.begin(), batch.end());
+    pendingStatus.push_back(&status);
+
+    while (status == 0) {
+        if (leaderActive) {
+            commitDone.wait(lock);
+            continue;
+        }
+
+        leaderActive = true;
+        writingRecords.swap(pendingRecords);
+        writingStatus.swap(pendingStatus);
+        lock.unlock();
+
+        std::string batchError;
+        bool written = writeBatch(writingRecords, batchError);
+        if (written && durability == ScoreDurability::EVERY_WRITE && !syncFile(appendHandle)) {
+            written = false;
+            batchError = "Could not sync " + storePath;
+        }
+
+        lock.lock();
+        dirty = dirty || (written && durability != ScoreDurability::EVERY_WRITE);
+        for (int* waiting : writingStatus) {
+            *waiting = written ? 1 : -1;
+        }
+        if (!written) {
+            commitError = batchError;
+        }
+        writingRecords.clear();
+        writingStatus.clear();
+        leaderActive = false;
+        commitDone.notify_all();
+    }
+    probe.finish(batch.size());
+
+    if (status < 0) {
+        error = commitError;
+        return false;
+    }
+    return true;
+}
+
+// The cross-process critical section: one write at the end of the file
+bool ScoreStore::writeBatch(const std::vector<ScoreRecord>& batch, std::string& error) {
+    StoreLock lock(lockHandle);
+    if (!lock.held()) {
+        error = "Could not lock " + storePath;
+        return false;
+    }
+
+    uint64_t size = 0;
+    if (!prepareAppend(size, error)) {
+        return false;
+    }
+    if (!writeFully(appendHandle, batch.data(), batch.size() * sizeof(ScoreRecord))) {
+        error = "Could not write to " + storePath;
+        return false;
+    }
+    return true;
+}
+
+// Point the append handle at the file now at the store's path and find
+// its size. A partial record left by a writer that died mid-write is
+// dropped first so the new records stay aligned. Needs the store lock.
+bool ScoreStore::prepareAppend(uint64_t& size, std::string& error) {
+    if (!stillAtPath(appendHandle, storePath)) {
+        ScoreFileHandle reopened = openForAppend(storePath);
+        if (reopened == NO_FILE) {
+            error = "Could not reopen " + storePath;
+            return false;
+        }
+        syncFile(appendHandle); // its records may still be unsynced
+        closeFile(appendHandle);
+        appendHandle = reopened;
+    }
+
+    if (!fileSize(appendHandle, size) || size < sizeof(ScoreStoreHeader)) {
+        error = "Could not read the size of " + storePath;
+        return false;
+    }
+    uint64_t aligned = sizeof(ScoreStoreHeader) +
+                       (size - sizeof(ScoreStoreHeader)) / sizeof(ScoreRecord) * sizeof(ScoreRecord);
+    if (aligned != size && !truncateFile(appendHandle, aligned)) {
+        error = "Could not truncate a partial record in " + storePath;
+        return false;
+    }
+    size = aligned;
+    return true;
+}
+
+// Holds the leader role, so nothing else in this process writes or syncs,
+// and the store lock from the size check to the last write
+bool ScoreStore::appendIfEmpty(const BatchSource& source, uint64_t& appended, std::string& error) {
+    appended = 0;
+    std::unique_lock<std::mutex> guard(commitMutex);
+    if (appendHandle == NO_FILE) {
+        error = "Score store is not open";
+        return false;
+    }
+    while (leaderActive) {
+        commitDone.wait(guard);
+    }
+    leaderActive = true;
+    guard.unlock();
+
+    bool written = false;
+    {
+        StoreLock lock(lockHandle);
+        uint64_t size = 0;
+        if (!lock.held()) {
+            error = "Could not lock " + storePath;
+        } else if (prepareAppend(size, error)) {
+            written = true;
+            std::vector<ScoreRecord> batch;
+            bool more = size == sizeof(ScoreStoreHeader);
+            while (more && written) {
+                batch.clear();
+                more = source(batch);
+                written = writeFully(appendHandle, batch.data(), batch.size() * sizeof(ScoreRecord));
+                appended += written ? batch.size() : 0;
+            }
+            if (!written) {
+                error = "Could not write to " + storePath;
+            }
+        }
+    }
+    if (written && appended > 0 && durability == ScoreDurability::EVERY_WRITE && !syncFile(appendHandle)) {
+        error = "Could not sync " + storePath;
+        written = false;
+    }
+
+    guard.lock();
+    dirty = dirty || (appended > 0 && durability != ScoreDurability::EVERY_WRITE);
+    leaderActive = false;
+    commitDone.notify_all();
+    return written;
+}
+
+// Remap if the store grew or was replaced since it was last mapped
+bool ScoreStore::refresh(std::string& error) {
+    uint64_t id = 0;
+    uint64_t size = 0;
+    if (header != nullptr && pathIdentity(storePath, id, size) &&
+        id == mappedId && size == mappedSize) {
+        return true;
+    }
+
+    if (!mapStore(error)) {
+        return false;
+    }
+    if (index == nullptr || index->storeId != header->storeId) {
+        mapIndex();
+    }
+    return true;
+}
+
+// Sort every intact record number by score within its difficulty and by
+// date, then write the index next to the store and swap it in. Everything
+// from the sync on runs under the store lock: the sync covers records other
+// processes appended without syncing, and no record appears meanwhile that
+// the index would claim but the sync missed.
+bool ScoreStore::buildIndex(std::string& error) {
+    if (!isOpen()) {
+        error = "Score store is not open";
+        return false;
+    }
+    if (!sync()) {
+        error = "Could not sync " + storePath;
+        return false;
+    }
+
+    StoreLock lock(lockHandle);
+    if (!lock.held()) {
+        error = "Could not lock " + storePath;
+        return false;
+    }
+    ScoreFileHandle current = openForAppend(storePath);
+    bool synced = current != NO_FILE && syncFile(current);
+    closeFile(current);
+    if (!synced) {
+        error = "Could not sync " + storePath;
+        return false;
+    }
+    if (!refresh(error)) {
+        return false;
+    }
+
+    // Damaged records stay out of the index; queries never return them
+    std::vector<uint32_t> byScore[SCORE_DIFFICULTY_COUNT];
+    std::vector<uint32_t> byDate;
+    byDate.reserve(records);
+    const ScoreRecord* data = recordData();
+    for (uint32_t i = 0; i < records; i++) {
+        if (!scoreRecordValid(data[i])) {
+            continue;
+        }
+        if (data[i].difficulty < SCORE_DIFFICULTY_COUNT) {
+            byScore[data[i].difficulty].push_back(i);
+        }
+        byDate.push_back(i);
+    }
+    for (auto& list : byScore) {
+        std::stable_sort(list.begin(), list.end(), [data](uint32_t a, uint32_t b) {
+            return data[a].score > data[b].score;
+        });
+    }
+    std::stable_sort(byDate.begin(), byDate.end(), [data](uint32_t a, uint32_t b) {
+        return data[a].timestamp < data[b].timestamp;
+    });
+
+    ScoreIndexHeader fresh;
+    std::memset(&fresh, 0, sizeof(fresh));
+    fresh.magic = SCORE_INDEX_MAGIC;
+    fresh.version = SCORE_INDEX_VERSION;
+    fresh.storeId = header->storeId;
+    fresh.indexedRecords = records;
+    uint64_t offset = sizeof(ScoreIndexHeader);
+    for (int i = 0; i < SCORE_DIFFICULTY_COUNT; i++) {
+        fresh.byScoreOffset[i] = static_cast<uint32_t>(offset);
+        fresh.byScoreCount[i] = static_cast<uint32_t>(byScore[i].size());
+        offset += byScore[i].size() * sizeof(uint32_t);
+    }
+    fresh.byDateOffset = static_cast<uint32_t>(offset);
+    fresh.byDateCount = static_cast<uint32_t>(byDate.size());
+    offset += byDate.size() * sizeof(uint32_t);
+    if (offset > UINT32_MAX) {
+        error = "Score index would be too large";
+        return false;
+    }
+
+    // Still under the store lock, so processes compacting at the same time
+    // do not share the temporary file
+    std::string temporary = indexPath() + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        error = "Could not create " + temporary;
+        return false;
+    }
+    bool written = writeAll(file, &fresh, sizeof(fresh));
+    for (const auto& list : byScore) {
+        written = written && writeAll(file, list.data(), list.size() * sizeof(uint32_t));
+    }
+    written = written && writeAll(file, byDate.data(), byDate.size() * sizeof(uint32_t));
+    written = written && syncStream(file);
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::remove(temporary.c_str());
+        error = "Could not write " + temporary;
+        return false;
+    }
+
+    indexFile.close(); // Windows cannot replace a mapped file
+    index = nullptr;
+    if (!replaceFile(temporary, indexPath()) || !syncDirectory(indexPath())) {
+        error = "Could not replace " + indexPath();
+        return false;
+    }
+    mapIndex();
+    return true;
+}
+
+// Best scores for one difficulty
+void ScoreStore::top(ScoreDifficulty difficulty, size_t count, std::vector<uint32_t>& result) const {
+    result.clear();
+    if (count == 0 || difficulty >= SCORE_DIFFICULTY_COUNT) {
+        return;
+    }
+
+    uint32_t first = 0;
+    if (index != nullptr) {
+        const uint32_t* ranked = indexList(index->byScoreOffset[difficulty]);
+        size_t taken = std::min<size_t>(count, index->byScoreCount[difficulty]);
+        result.assign(ranked, ranked + taken);
+        first = index->indexedRecords;
+    }
+
+    const ScoreRecord* data = recordData();
+    for (uint32_t i = first; i < records; i++) {
+        if (data[i].difficulty == difficulty && scoreRecordValid(data[i])) {
+            insertRanked(*this, result, i, count);
+        }
+    }
+}
+
+// Best scores overall, merged from the per-difficulty lists
+void ScoreStore::top(size_t count, std::vector<uint32_t>& result) const {
+    std::vector<uint32_t> merged;
+    std::vector<uint32_t> ranked;
+    for (int i = 0; i < SCORE_DIFFICULTY_COUNT; i++) {
+        top(static_cast<ScoreDifficulty>(i), count, ranked);
+        merged.insert(merged.end(), ranked.begin(), ranked.end());
+    }
+
+    const ScoreRecord* data = recordData();
+    std::sort(merged.begin(), merged.end(), [data](uint32_t a, uint32_t b) {
+        return data[a].score != data[b].score ? data[a].score > data[b].score : a < b;
+    });
+    if (merged.size() > count) {
+        merged.resize(count);
+    }
+    result.swap(merged);
+}
+
+// Records in a time range, found by binary search over the date index
+void ScoreStore::between(int64_t from, int64_t to, std::vector<uint32_t>& result) const {
+    result.clear();
+    const ScoreRecord* data = recordData();
+
+    uint32_t first = 0;
+    if (index != nullptr) {
+        const uint32_t* byDate = indexList(index->byDateOffset);
+        const uint32_t* end = byDate + index->byDateCount;
+        auto before = [data](uint32_t number, int64_t time) {
+            return data[number].timestamp < time;
+        };
+        const uint32_t* low = std::lower_bound(byDate, end, from, before);
+        const uint32_t* high = std::lower_bound(low, end, to, before);
+        result.assign(low, high);
+        first = index->indexedRecords;
+    }
+
+    bool unsorted = false;
+    for (uint32_t i = first; i < records; i++) {
+        if (data[i].timestamp >= from && data[i].timestamp < to && scoreRecordValid(data[i])) {
+            unsorted = unsorted || (!result.empty() && data[result.back()].timestamp > data[i].timestamp);
+            result.push_back(i);
+        }
+    }
+    if (unsorted) {
+        std::stable_sort(result.begin(), result.end(), [data](uint32_t a, uint32_t b) {
+            return data[a].timestamp < data[b].timestamp;
+        });
+    }
+}
@@ -0,0 +1,374 @@
+// RoboQuest - A text-based adventure game in C++
+// script_compiler.cpp - Implementation of the ScriptCompiler class
+
+#include "../include/script_compiler.h"
+#include "../include/script_vm.h"
+#include "../include/world.h"
+#include <cctype>
+#include <cstring>
+#include <sstream>
+
+namespace {
+
+// Words with a meaning of their own in expressions
+const char* const RESERVED[] = {"and", "or", "not", "has", "flag", "in", "score", "time"};
+
+bool reserved(const std::string& word) {
+    for (const char* name : RESERVED) {
+        if (word == name) return true;
+    }
+    return false;
+}
+
+// Split "keyword rest of line" into its two parts
+void splitKeyword(const std::string& line, std::string& keyword, std::string& rest) {
+    size_t space = line.find_first_of(" \t");
+    if (space == std::string::npos) {
+        keyword = line;
+        rest.clear();
+    } else {
+        keyword = line.substr(0, space);
+        size_t begin = line.find_first_not_of(" \t", space);
+        rest = begin == std::string::npos ? std::string() : line.substr(begin);
+    }
+}
+
+// An open if, else or while and the jump waiting for its end
+struct OpenBlock {
+    enum Kind { IF, ELSE, WHILE } kind;
+    size_t loopStart; // first instruction of a while's condition
+    size_t pending;   // jump to patch with the end of the block
+    int line;
+};
+
+} // namespace
+
+// Constructor
+ScriptCompiler::ScriptCompiler() : names(nullptr), position(0), errorLine(0), currentLine(0) {
+}
+
+// Record an error on the line being compiled
+bool ScriptCompiler::fail(const std::string& message) {
+    error = message;
+    errorLine = currentLine;
+    return false;
+}
+
+// Split an expression into names, numbers and operators
+bool ScriptCompiler::tokenize(const std::string& text) {
+    tokens.clear();
+    position = 0;
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (std::isspace(c)) {
+            i++;
+        } else if (std::isalpha(c) || c == '_') {
+            size_t begin = i;
+            while (i < text.size() && (std::isalnum(static_cast<unsigned char>(text[i])) || text[i] == '_')) i++;
+            tokens.push_back({Token::NAME, text.substr(begin, i - begin), 0});
+        } else if (std::isdigit(c)) {
+            int64_t value = 0;
+            while (i < text.size() && std::isdigit(static_cast<unsigned char>(text[i]))) {
+                value = value * 10 + (text[i++] - '0');
+                if (value > INT32_MAX) return fail("number is too large");
+            }
+            tokens.push_back({Token::NUMBER, std::string(), static_cast<int32_t>(value)});
+        } else {
+            static const char* const SYMBOLS[] = {"==", "!=", "<=", ">=", "<", ">", "=", "+", "-", "*", "/", "%", "(", ")"};
+            const char* match = nullptr;
+            for (const char* symbol : SYMBOLS) {
+                if (text.compare(i, std::strlen(symbol), symbol) == 0) {
+                    match = symbol;
+                    break;
+                }
+            }
+            if (match == nullptr) return fail(std::string("unexpected '") + text[i] + "'");
+            tokens.push_back({Token::SYMBOL, match, 0});
+            i += std::strlen(match);
+        }
+    }
+    tokens.push_back({Token::END, std::string(), 0});
+    return true;
+}
+
+// Consume the next token if it is the given operator or keyword
+bool ScriptCompiler::accept(const char* symbol) {
+    const Token& token = tokens[position];
+    if (token.kind != Token::END && token.kind != Token::NUMBER && token.text == symbol) {
+        position++;
+        return true;
+    }
+    return false;
+}
+
+bool ScriptCompiler::emit(uint32_t instruction) {
+    code.push_back(instruction);
+    return true;
+}
+
+// Emit a jump whose target is filled in later by patchJump()
+bool ScriptCompiler::emitJump(int op, int reg, size_t& patch) {
+    patch = code.size();
+    return emit(scriptInstruction(static_cast<ScriptOp>(op), reg, 0));
+}
+
+bool ScriptCompiler::patchJump(size_t patch, size_t target) {
+    int64_t offset = static_cast<int64_t>(target) - static_cast<int64_t>(patch + 1);
+    if (offset < INT16_MIN || offset > INT16_MAX) return fail("script is too long");
+    code[patch] = (code[patch] & 0xFFFF) | static_cast<uint32_t>(offset & 0xFFFF) << 16;
+    return true;
+}
+
+bool ScriptCompiler::loadNumber(int reg, int32_t value) {
+    if (value >= INT16_MIN && value <= INT16_MAX) {
+        return emit(scriptInstruction(OP_LOADI, reg, value));
+    }
+    if (constants.size() > UINT16_MAX) return fail("too many constants");
+    constants.push_back(value);
+    return emit(scriptInstruction(OP_LOADK, reg, static_cast<int>(constants.size() - 1)));
+}
+
+int ScriptCompiler::lookup(const std::vector<std::string>& keys, const std::string& key) const {
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (keys[i] == key) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// World flag bit for a name, giving new names the next free bit, or -1
+int ScriptCompiler::flag(const std::string& name) {
+    int bit = lookup(names->flags, name);
+    if (bit < 0 && names->flags.size() < static_cast<size_t>(WORLD_FLAG_COUNT)) {
+        names->flags.push_back(name);
+        bit = static_cast<int>(names->flags.size() - 1);
+    }
+    if (bit < 0) fail("more than " + std::to_string(WORLD_FLAG_COUNT) + " flags");
+    return bit;
+}
+
+// Counter slot for a name, giving new names the next free slot, or -1
+int ScriptCompiler::counter(const std::string& name) {
+    if (reserved(name)) {
+        fail("'" + name + "' cannot be a counter");
+        return -1;
+    }
+    int slot = lookup(names->counters, name);
+    if (slot < 0 && names->counters.size() < static_cast<size_t>(WORLD_COUNTER_COUNT)) {
+        names->counters.push_back(name);
+        slot = static_cast<int>(names->counters.size() - 1);
+    }
+    if (slot < 0) fail("more than " + std::to_string(WORLD_COUNTER_COUNT) + " counters");
+    return slot;
+}
+
+// A whole expression, as the condition of if and while or a value
+bool ScriptCompiler::condition(const std::string& text, int reg) {
+    if (!tokenize(text) || !parseOr(reg)) return false;
+    if (tokens[position].kind != Token::END) return fail("unexpected text after the expression");
+    return true;
+}
+
+bool ScriptCompiler::parseOr(int reg) {
+    if (!parseAnd(reg)) return false;
+    while (accept("or")) {
+        if (!parseAnd(reg + 1)) return false;
+        emit(scriptInstruction(OP_OR, reg, reg, reg + 1));
+    }
+    return true;
+}
+
+bool ScriptCompiler::parseAnd(int reg) {
+    if (!parseNot(reg)) return false;
+    while (accept("and")) {
+        if (!parseNot(reg + 1)) return false;
+        emit(scriptInstruction(OP_AND, reg, reg, reg + 1));
+    }
+    return true;
+}
+
+bool ScriptCompiler::parseNot(int reg) {
+    if (accept("not")) {
+        if (!parseNot(reg)) return false;
+        return emit(scriptInstruction(OP_NOT, reg, reg, 0));
+    }
+    return parseComparison(reg);
+}
+
+bool ScriptCompiler::parseComparison(int reg) {
+    if (!parseSum(reg)) return false;
+    struct Comparison {
+        const char* symbol;
+        ScriptOp op;
+        bool swap; // a > b is b < a
+    };
+    static const Comparison COMPARISONS[] = {
+        {"==", OP_EQ, false}, {"!=", OP_NE, false}, {"<", OP_LT, false},
+        {"<=", OP_LE, false}, {">", OP_LT, true}, {">=", OP_LE, true},
+    };
+    for (const Comparison& comparison : COMPARISONS) {
+        if (accept(comparison.symbol)) {
+            if (!parseSum(reg + 1)) return false;
+            return comparison.swap ? emit(scriptInstruction(comparison.op, reg, reg + 1, reg))
+                                   : emit(scriptInstruction(comparison.op, reg, reg, reg + 1));
+        }
+    }
+    return true;
+}
+
+bool ScriptCompiler::parseSum(int reg) {
+    if (!parseProduct(reg)) return false;
+    while (true) {
+        ScriptOp op;
+        if (accept("+")) op = OP_ADD;
+        else if (accept("-")) op = OP_SUB;
+        else return true;
+        if (!parseProduct(reg + 1)) return false;
+        emit(scriptInstruction(op, reg, reg, reg + 1));
+    }
+}
+
+bool ScriptCompiler::parseProduct(int reg) {
+    if (!parseUnary(reg)) return false;
+    while (true) {
+        ScriptOp op;
+        if (accept("*")) op = OP_MUL;
+        else if (accept("/")) op = OP_DIV;
+        else if (accept("%")) op = OP_MOD;
+        else return true;
+        if (!parseUnary(reg + 1)) return false;
+        emit(scriptInstruction(op, reg, reg, reg + 1));
+    }
+}
+
+bool ScriptCompiler::parseUnary(int reg) {
+    if (accept("-")) {
+        if (!parseUnary(reg)) return false;
+        return emit(scriptInstruction(OP_NEG, reg, reg, 0));
+    }
+    return parsePrimary(reg);
+}
+
+bool ScriptCompiler::parsePrimary(int reg) {
+    if (reg >= ScriptVM::REGISTER_COUNT) return fail("expression is too complex");
+
+    const Token token = tokens[position];
+    if (token.kind == Token::NUMBER) {
+        position++;
+        return loadNumber(reg, token.value);
+    }
+    if (accept("(")) {
+        if (!parseOr(reg)) return false;
+        return accept(")") || fail("expected ')'");
+    }
+    if (token.kind != Token::NAME) return fail("expected a value");
+    position++;
+
+    if (token.text == "score") return emit(scriptInstruction(OP_GETSCORE, reg, 0));
+    if (token.text == "time") return emit(scriptInstruction(OP_GETTIME, reg, 0));
+    if (token.text == "has" || token.text == "flag" || token.text == "in") {
+        const Token& name = tokens[position];
+        if (name.kind != Token::NAME) return fail("expected a name after '" + token.text + "'");
+        position++;
+        if (token.text == "flag") {
+            int bit = flag(name.text);
+            return bit >= 0 && emit(scriptInstruction(OP_FLAG, reg, bit));
+        }
+        bool item = token.text == "has";
+        int index = lookup(item ? names->items : names->rooms, name.text);
+        if (index < 0) return fail(std::string(item ? "unknown item '" : "unknown room '") + name.text + "'");
+        return emit(scriptInstruction(item ? OP_HAS : OP_INROOM, reg, index));
+    }
+    if (reserved(token.text)) return fail("unexpected '" + token.text + "'");
+
+    int slot = counter(token.text);
+    return slot >= 0 && emit(scriptInstruction(OP_GETVAR, reg, slot));
+}
+
+bool ScriptCompiler::compile(const std::vector<ScriptLine>& lines, ScriptNames& scriptNames, uint32_t& start) {
+    names = &scriptNames;
+    error.clear();
+    errorLine = 0;
+    currentLine = lines.empty() ? 0 : lines.front().line;
+    start = static_cast<uint32_t>(code.size());
+
+    std::vector<OpenBlock> blocks;
+    for (const ScriptLine& line : lines) {
+        currentLine = line.line;
+        std::string keyword;
+        std::string rest;
+        splitKeyword(line.text, keyword, rest);
+
+        if (keyword == "if" || keyword == "while") {
+            OpenBlock block;
+            block.kind = keyword == "if" ? OpenBlock::IF : OpenBlock::WHILE;
+            block.loopStart = code.size();
+            block.line = line.line;
+            if (!condition(rest, 0) || !emitJump(OP_JUMPIFNOT, 0, block.pending)) return false;
+            blocks.push_back(block);
+        } else if (keyword == "else") {
+            if (blocks.empty() || blocks.back().kind != OpenBlock::IF) return fail("'else' without 'if'");
+            size_t skip;
+            emitJump(OP_JUMP, 0, skip);
+            if (!patchJump(blocks.back().pending, code.size())) return false;
+            blocks.back().kind = OpenBlock::ELSE;
+            blocks.back().pending = skip;
+        } else if (keyword == "end") {
+            if (blocks.empty()) return fail("'end' without 'if' or 'while'");
+            OpenBlock block = blocks.back();
+            blocks.pop_back();
+            if (block.kind == OpenBlock::WHILE) {
+                size_t back;
+                emitJump(OP_JUMP, 0, back);
+                if (!patchJump(back, block.loopStart)) return false;
+            }
+            if (!patchJump(block.pending, code.size())) return false;
+        } else if (keyword == "let") {
+            if (!tokenize(rest)) return false;
+            const Token name = tokens[position];
+            if (name.kind != Token::NAME) return fail("expected 'let <counter> = <value>'");
+            position++;
+            if (!accept("=")) return fail("expected 'let <counter> = <value>'");
+            int slot = counter(name.text);
+            if (slot < 0 || !parseOr(0)) return false;
+            if (tokens[position].kind != Token::END) return fail("unexpected text after the expression");
+            emit(scriptInstruction(OP_SETVAR, 0, slot));
+        } else if (keyword == "score" || keyword == "time") {
+            if (!condition(rest, 0)) return false;
+            emit(scriptInstruction(keyword == "score" ? OP_ADDSCORE : OP_ADDTIME, 0, 0));
+        } else if (keyword == "say") {
+            if (strings.size() > UINT16_MAX) return fail("too many strings");
+            strings.push_back(rest);
+            emit(scriptInstruction(OP_SAY, 0, static_cast<int>(strings.size() - 1)));
+        } else if (keyword == "set" || keyword == "clear" || keyword == "give" || keyword == "consume") {
+            std::istringstream words(rest);
+            std::string word;
+            bool any = false;
+            while (words >> word) {
+                any = true;
+                if (keyword == "set" || keyword == "clear") {
+                    int bit = flag(word);
+                    if (bit < 0) return false;
+                    emit(scriptInstruction(keyword == "set" ? OP_SET : OP_CLEAR, 0, bit));
+                } else {
+                    int item = lookup(names->items, word);
+                    if (item < 0) return fail("unknown item '" + word + "'");
+                    emit(scriptInstruction(keyword == "give" ? OP_GIVE : OP_CONSUME, 0, item));
+                }
+            }
+            if (!any) return fail("expected a name after '" + keyword + "'");
+        } else if (keyword == "map") {
+            emit(scriptInstruction(OP_MAP, 0, 0));
+        } else if (keyword == "stop") {
+            emit(scriptInstruction(OP_END, 0, 0));
+        } else {
+            return fail("unknown script statement '" + keyword + "'");
+        }
+    }
+
+    if (!blocks.empty()) {
+        currentLine = blocks.back().line;
+        return fail("missing 'end'");
+    }
+    return emit(scriptInstruction(OP_END, 0, 0));
+}
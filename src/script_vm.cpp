@@ -0,0 +1,281 @@
+// RoboQuest - A text-based adventure game in C++
+// script_vm.cpp - Implementation of the ScriptVM class
+
+#include "../include/script_vm.h"
+#include "../include/game_state.h"
+#include "../include/rule_table.h"
+#include "../include/world.h"
+
+static_assert(WORLD_COUNTER_COUNT == SESSION_COUNTER_COUNT, "every script counter needs a place in GameState");
+
+namespace {
+
+int operandA(uint32_t instruction) {
+    return static_cast<int>((instruction >> 8) & 0xFF);
+}
+
+int operandB(uint32_t instruction) {
+    return static_cast<int>((instruction >> 16) & 0xFF);
+}
+
+int operandC(uint32_t instruction) {
+    return static_cast<int>(instruction >> 24);
+}
+
+// The 16-bit operand, as an index or sign-extended
+int operandX(uint32_t instruction) {
+    return static_cast<int>(instruction >> 16);
+}
+
+int operandSX(uint32_t instruction) {
+    return static_cast<int16_t>(instruction >> 16);
+}
+
+// Wrapping arithmetic, so no script can reach undefined behaviour
+int32_t wrap(uint32_t value) {
+    return static_cast<int32_t>(value);
+}
+
+uint32_t worldFlag(int bit) {
+    return 1u << (bit + WORLD_FLAG_SHIFT);
+}
+
+bool scriptRefersOk(int script, const World& world) {
+    return script == WORLD_NO_SCRIPT || (script >= 0 && script < world.scriptCount());
+}
+
+} // namespace
+
+// Constructor
+ScriptVM::ScriptVM() : budget(TURN_BUDGET) {
+}
+
+bool ScriptVM::verify(const World& world, std::string& error) {
+    const uint32_t* code = world.scriptCode();
+    for (int s = 0; s < world.scriptCount(); s++) {
+        const WorldScriptRecord& script = world.script(s);
+        std::string name(world.text(script.name));
+        if (script.codeLength == 0 || script.codeStart > static_cast<uint32_t>(world.scriptCodeSize()) ||
+            script.codeLength > static_cast<uint32_t>(world.scriptCodeSize()) - script.codeStart ||
+            (code[script.codeStart + script.codeLength - 1] & 0xFF) != OP_END) {
+            error = "script '" + name + "' is corrupt";
+            return false;
+        }
+
+        int length = static_cast<int>(script.codeLength);
+        for (int pc = 0; pc < length; pc++) {
+            uint32_t instruction = code[script.codeStart + pc];
+            int op = static_cast<int>(instruction & 0xFF);
+            int x = operandX(instruction);
+            bool ok = op < OP_COUNT && operandA(instruction) < REGISTER_COUNT;
+            switch (op) {
+                case OP_LOADK:
+                    ok = ok && x < world.scriptConstantCount();
+                    break;
+                case OP_MOVE:
+                case OP_NOT:
+                case OP_NEG:
+                    ok = ok && operandB(instruction) < REGISTER_COUNT;
+                    break;
+                case OP_GETVAR:
+                case OP_SETVAR:
+                    ok = ok && x < WORLD_COUNTER_COUNT;
+                    break;
+                case OP_INROOM:
+                    ok = ok && x < world.roomCount();
+                    break;
+                case OP_HAS:
+                case OP_GIVE:
+                case OP_CONSUME:
+                    ok = ok && x < world.itemCount();
+                    break;
+                case OP_FLAG:
+                case OP_SET:
+                case OP_CLEAR:
+                    ok = ok && x < WORLD_FLAG_COUNT;
+                    break;
+                case OP_ADD:
+                case OP_SUB:
+                case OP_MUL:
+                case OP_DIV:
+                case OP_MOD:
+                case OP_EQ:
+                case OP_NE:
+                case OP_LT:
+                case OP_LE:
+                case OP_AND:
+                case OP_OR:
+                    ok = ok && operandB(instruction) < REGISTER_COUNT && operandC(instruction) < REGISTER_COUNT;
+                    break;
+                case OP_JUMP:
+                case OP_JUMPIFNOT: {
+                    int target = pc + 1 + operandSX(instruction);
+                    ok = ok && target >= 0 && target < length;
+                    break;
+                }
+                case OP_SAY:
+                    ok = ok && x < world.scriptStringCount();
+                    break;
+                default:
+                    break;
+            }
+            if (!ok) {
+                error = "script '" + name + "' has a bad instruction at " + std::to_string(pc);
+                return false;
+            }
+        }
+    }
+
+    // Everything that names a script
+    bool references = scriptRefersOk(world.turnScript(), world);
+    for (int room = 0; room < world.roomCount(); room++) {
+        references = references && scriptRefersOk(world.room(room).enterScript, world);
+    }
+    for (int rule = 0; rule < world.ruleCount(); rule++) {
+        references = references && scriptRefersOk(world.rule(rule).script, world);
+    }
+    if (!references) {
+        error = "world image refers to a script it does not have";
+        return false;
+    }
+    return true;
+}
+
+bool ScriptVM::readsTimeOrScore(const World& world) {
+    const uint32_t* code = world.scriptCode();
+    for (int pc = 0; pc < world.scriptCodeSize(); pc++) {
+        uint32_t op = code[pc] & 0xFF;
+        if (op == OP_GETSCORE || op == OP_GETTIME) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ScriptVM::run(const World& world, int script, GameState& state, ScriptHost& host) {
+    const uint32_t* pc = world.scriptCode() + world.script(script).codeStart;
+    const int32_t* constants = world.scriptConstants();
+    int32_t r[REGISTER_COUNT] = {};
+
+    while (budget > 0) {
+        budget--;
+        uint32_t instruction = *pc++;
+        int a = operandA(instruction);
+        switch (static_cast<ScriptOp>(instruction & 0xFF)) {
+            case OP_END:
+                return true;
+            case OP_LOADI:
+                r[a] = operandSX(instruction);
+                break;
+            case OP_LOADK:
+                r[a] = constants[operandX(instruction)];
+                break;
+            case OP_MOVE:
+                r[a] = r[operandB(instruction)];
+                break;
+            case OP_GETVAR:
+                r[a] = state.counters[operandX(instruction)];
+                break;
+            case OP_SETVAR:
+                state.counters[operandX(instruction)] = r[a];
+                break;
+            case OP_GETSCORE:
+                r[a] = state.score;
+                break;
+            case OP_GETTIME:
+                r[a] = state.timeRemaining;
+                break;
+            case OP_INROOM:
+                r[a] = state.room == operandX(instruction);
+                break;
+            case OP_HAS:
+                r[a] = state.inventory.has(static_cast<ItemId>(operandX(instruction)));
+                break;
+            case OP_FLAG:
+                r[a] = state.hasFlag(worldFlag(operandX(instruction)));
+                break;
+            case OP_ADD:
+                r[a] = wrap(static_cast<uint32_t>(r[operandB(instruction)]) + static_cast<uint32_t>(r[operandC(instruction)]));
+                break;
+            case OP_SUB:
+                r[a] = wrap(static_cast<uint32_t>(r[operandB(instruction)]) - static_cast<uint32_t>(r[operandC(instruction)]));
+                break;
+            case OP_MUL:
+                r[a] = wrap(static_cast<uint32_t>(r[operandB(instruction)]) * static_cast<uint32_t>(r[operandC(instruction)]));
+                break;
+            case OP_DIV:
+            case OP_MOD: {
+                int32_t b = r[operandB(instruction)];
+                int32_t c = r[operandC(instruction)];
+                bool divide = (instruction & 0xFF) == OP_DIV;
+                if (c == 0) {
+                    r[a] = 0;
+                } else if (c == -1) {
+                    r[a] = divide ? wrap(0u - static_cast<uint32_t>(b)) : 0;
+                } else {
+                    r[a] = divide ? b / c : b % c;
+                }
+                break;
+            }
+            case OP_EQ:
+                r[a] = r[operandB(instruction)] == r[operandC(instruction)];
+                break;
+            case OP_NE:
+                r[a] = r[operandB(instruction)] != r[operandC(instruction)];
+                break;
+            case OP_LT:
+                r[a] = r[operandB(instruction)] < r[operandC(instruction)];
+                break;
+            case OP_LE:
+                r[a] = r[operandB(instruction)] <= r[operandC(instruction)];
+                break;
+            case OP_AND:
+                r[a] = r[operandB(instruction)] != 0 && r[operandC(instruction)] != 0;
+                break;
+            case OP_OR:
+                r[a] = r[operandB(instruction)] != 0 || r[operandC(instruction)] != 0;
+                break;
+            case OP_NOT:
+                r[a] = r[operandB(instruction)] == 0;
+                break;
+            case OP_NEG:
+                r[a] = wrap(0u - static_cast<uint32_t>(r[operandB(instruction)]));
+                break;
+            case OP_JUMP:
+                pc += operandSX(instruction);
+                break;
+            case OP_JUMPIFNOT:
+                if (r[a] == 0) {
+                    pc += operandSX(instruction);
+                }
+                break;
+            case OP_SAY:
+                host.scriptSay(world.scriptString(operandX(instruction)));
+                break;
+            case OP_ADDSCORE:
+                state.score = wrap(static_cast<uint32_t>(state.score) + static_cast<uint32_t>(r[a]));
+                break;
+            case OP_ADDTIME:
+                host.scriptAddTime(r[a]);
+                break;
+            case OP_SET:
+                state.setFlag(worldFlag(operandX(instruction)));
+                break;
+            case OP_CLEAR:
+                state.clearFlag(worldFlag(operandX(instruction)));
+                break;
+            case OP_GIVE:
+                state.inventory.add(static_cast<ItemId>(operandX(instruction)));
+                break;
+            case OP_CONSUME:
+                state.inventory.remove(static_cast<ItemId>(operandX(instruction)));
+                break;
+            case OP_MAP:
+                host.scriptShowMap();
+                break;
+            case OP_COUNT:
+                return true;
+        }
+    }
+    return false;
+}
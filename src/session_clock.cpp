@@ -0,0 +1,68 @@
+// RoboQuest - A text-based adventure game in C++
+// session_clock.cpp - Implementation of the SessionClock class
+
+#include "../include/session_clock.h"
+#include "../include/game.h"
+#include <algorithm>
+#include <cstdint>
+
+// Constructor
+SessionClock::SessionClock() :
+    origin(std::chrono::steady_clock::now()),
+    manual(false),
+    manualTick(0) {
+}
+
+uint64_t SessionClock::currentTick() const {
+    if (manual) {
+        return manualTick;
+    }
+    auto elapsed = std::chrono::steady_clock::now() - origin;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()) / TICK_MS;
+}
+
+TimerHandle SessionClock::start(Game& game, int seconds) {
+    return start(game, seconds, currentTick());
+}
+
+TimerHandle SessionClock::start(Game& game, int seconds, uint64_t tick) {
+    uint64_t ticks = seconds > 0 ? static_cast<uint64_t>(seconds) * 1000 / TICK_MS : 0;
+    return wheel.schedule(tick + ticks, reinterpret_cast<uintptr_t>(&game));
+}
+
+void SessionClock::stop(TimerHandle countdown) {
+    wheel.cancel(countdown);
+}
+
+bool SessionClock::extend(TimerHandle countdown, int seconds) {
+    return wheel.extend(countdown, static_cast<int64_t>(seconds) * 1000 / TICK_MS);
+}
+
+int64_t SessionClock::remainingMilliseconds(TimerHandle countdown) const {
+    return remainingMilliseconds(countdown, currentTick());
+}
+
+int64_t SessionClock::remainingMilliseconds(TimerHandle countdown, uint64_t now) const {
+    uint64_t deadline;
+    if (!wheel.deadline(countdown, deadline) || deadline <= now) {
+        return 0;
+    }
+    return static_cast<int64_t>((deadline - now) * TICK_MS);
+}
+
+void SessionClock::setTick(uint64_t tick) {
+    if (!manual) {
+        manualTick = currentTick();
+        manual = true;
+    }
+    manualTick = std::max(manualTick, tick);
+}
+
+size_t SessionClock::advance() {
+    expired.clear();
+    size_t fired = wheel.advance(currentTick(), expired);
+    for (uint64_t session : expired) {
+        reinterpret_cast<Game*>(static_cast<uintptr_t>(session))->expire();
+    }
+    return fired;
+}
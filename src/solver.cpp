@@ -0,0 +1,297 @@
+// solver.cpp - Implementation of the RouteSolver class
+
+#include "../include/solver.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+// One reached state and how it was reached
+struct Node {
+    GameState state;
+    uint32_t parent;  // index in the previous layer
+    uint32_t action;  // index into the action table
+};
+
+// The part of a state that must match for two states to compete
+struct StateKey {
+    int32_t room;
+    uint32_t flags;
+    ItemSet inventory;
+    int32_t counters[SESSION_COUNTER_COUNT];
+
+    bool operator==(const StateKey& other) const {
+        return room == other.room && flags == other.flags && inventory == other.inventory &&
+               std::equal(counters, counters + SESSION_COUNTER_COUNT, other.counters);
+    }
+};
+
+struct StateKeyHash {
+    size_t operator()(const StateKey& key) const {
+        uint64_t h = static_cast<uint64_t>(static_cast<uint32_t>(key.room)) << 32 | key.flags;
+        for (int i = 0; i < ItemSet::wordCount(); i++) {
+            h = (h ^ key.inventory.word(i)) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 32;
+        }
+        for (int32_t counter : key.counters) {
+            h = (h ^ static_cast<uint32_t>(counter)) * 0x9E3779B97F4A7C15ull;
+            h ^= h >> 32;
+        }
+        return static_cast<size_t>(h ^ (h >> 29));
+    }
+};
+
+StateKey keyOf(const GameState& state) {
+    StateKey key;
+    key.room = state.room;
+    key.flags = state.flags;
+    key.inventory = state.inventory;
+    std::copy(state.counters, state.counters + SESSION_COUNTER_COUNT, key.counters);
+    return key;
+}
+
+// Concurrent visited-set. Each key keeps the Pareto front of (time, score)
+// pairs seen so far; a state is new only if nothing on its front has at
+// least as much of both. When more of either may not be better, exact
+// keeps every distinct pair instead. Keys are spread over independently
+// locked shards.
+class VisitedSet {
+private:
+    struct Point {
+        int32_t time;
+        int32_t score;
+    };
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        std::unordered_map<StateKey, std::vector<Point>, StateKeyHash> fronts;
+    };
+
+    static const size_t SHARD_COUNT = 64;
+    Shard shards[SHARD_COUNT];
+    bool exact;
+
+public:
+    explicit VisitedSet(bool exactOnly) : exact(exactOnly) {}
+
+    // Returns true if the state is not dominated and was recorded
+    bool insert(const GameState& state) {
+        StateKey key = keyOf(state);
+        size_t hash = StateKeyHash()(key);
+        Shard& shard = shards[(hash >> 7) % SHARD_COUNT];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        std::vector<Point>& front = shard.fronts[key];
+        for (const Point& point : front) {
+            if (exact ? point.time == state.timeRemaining && point.score == state.score
+                      : point.time >= state.timeRemaining && point.score >= state.score) {
+                return false;
+            }
+        }
+        if (exact) {
+            front.push_back({state.timeRemaining, state.score});
+            return true;
+        }
+        front.erase(std::remove_if(front.begin(), front.end(), [&](const Point& point) {
+            return point.time <= state.timeRemaining && point.score <= state.score;
+        }), front.end());
+        front.push_back({state.timeRemaining, state.score});
+        return true;
+    }
+};
+
+// Interns menu commands so nodes can refer to them by index
+class ActionTable {
+private:
+    mutable std::mutex mutex;
+    std::vector<std::string> names;
+
+public:
+    uint32_t intern(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < names.size(); i++) {
+            if (names[i] == name) return static_cast<uint32_t>(i);
+        }
+        names.push_back(name);
+        return static_cast<uint32_t>(names.size() - 1);
+    }
+
+    std::string name(uint32_t index) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return names[index];
+    }
+};
+
+// Commands leading from the root to the given node
+std::vector<std::string> pathTo(const std::vector<std::vector<Node>>& layers, size_t layer, uint32_t index,
+                                const ActionTable& actions) {
+    std::vector<std::string> path;
+    while (layer > 0) {
+        const Node& node = layers[layer][index];
+        path.push_back(actions.name(node.action));
+        index = node.parent;
+        layer--;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+} // namespace
+
+// Search the state space breadth-first, one layer per turn
+bool RouteSolver::solve(const SolverOptions& options, SolverResult& result) {
+    result = SolverResult();
+
+    // One engine per worker, all writing into the void
+    NullSink discard;
+    std::vector<std::unique_ptr<Game>> games;
+    for (unsigned i = 0; i < pool.size(); i++) {
+        games.push_back(std::make_unique<Game>());
+        games.back()->setDifficulty(options.difficulty);
+        games.back()->setOutput(discard);
+        if (i > 0) {
+            games.back()->setWorld(games.front()->sharedWorld());
+        }
+        if (!games.back()->initialize()) {
+            return false;
+        }
+    }
+
+    // Scripts that read the score or time may do worse with more of them
+    result.pruned = !ScriptVM::readsTimeOrScore(games[0]->sharedWorld()->world);
+    VisitedSet visited(!result.pruned);
+    ActionTable actions;
+    std::vector<std::vector<Node>> layers;
+
+    Node root;
+    root.state = games[0]->snapshot();
+    root.parent = 0;
+    root.action = 0;
+    visited.insert(root.state);
+    layers.push_back(std::vector<Node>(1, root));
+    result.statesKept = 1;
+    result.bestScore = root.state.score;
+
+    std::mutex loopMutex;
+    std::atomic<bool> loopFound(false);
+    std::atomic<size_t> expanded(0);
+
+    for (int depth = 0; depth < options.maxTurns && !layers.back().empty(); depth++) {
+        const std::vector<Node>& current = layers.back();
+        std::vector<std::vector<Node>> produced(pool.size());
+
+        pool.parallelFor(current.size(), 256, [&](size_t begin, size_t end, unsigned worker) {
+            Game& game = *games[worker];
+            std::vector<Node>& output = produced[worker];
+            std::unordered_map<std::string, uint32_t> actionIds;
+            size_t localExpanded = 0;
+
+            for (size_t i = begin; i < end; i++) {
+                const Node& node = current[i];
+                if (!node.state.hasFlag(FLAG_RUNNING)) {
+                    continue; // escaped: nothing further to do
+                }
+
+                game.restore(node.state);
+                std::vector<std::string> menu = game.availableActions();
+                for (const std::string& action : menu) {
+                    if (action == "quit") {
+                        continue;
+                    }
+                    game.restore(node.state);
+                    game.step(game.parse(action));
+                    GameState next = game.snapshot();
+                    localExpanded++;
+
+                    bool escaped = next.hasFlag(FLAG_ESCAPED);
+                    if (!escaped && !next.hasFlag(FLAG_RUNNING)) {
+                        continue; // ran out of time
+                    }
+                    if (!visited.insert(next)) {
+                        continue;
+                    }
+
+                    auto id = actionIds.find(action);
+                    if (id == actionIds.end()) {
+                        id = actionIds.emplace(action, actions.intern(action)).first;
+                    }
+                    output.push_back({next, static_cast<uint32_t>(i), id->second});
+
+                    // A state that beats one of its own ancestors on score without
+                    // losing time can repeat the same commands forever, unless
+                    // scripts see the difference
+                    if (result.pruned && !loopFound.load(std::memory_order_relaxed)) {
+                        StateKey key = keyOf(next);
+                        std::vector<uint32_t> loop(1, id->second);
+                        size_t layer = layers.size() - 1;
+                        uint32_t index = static_cast<uint32_t>(i);
+                        while (true) {
+                            const Node& ancestor = layers[layer][index];
+                            if (keyOf(ancestor.state) == key &&
+                                ancestor.state.timeRemaining <= next.timeRemaining &&
+                                ancestor.state.score < next.score) {
+                                std::lock_guard<std::mutex> lock(loopMutex);
+                                if (!loopFound.exchange(true)) {
+                                    std::reverse(loop.begin(), loop.end());
+                                    for (uint32_t step : loop) {
+                                        result.scoreLoop.push_back(actions.name(step));
+                                    }
+                                }
+                                break;
+                            }
+                            if (layer == 0) break;
+                            loop.push_back(ancestor.action);
+                            index = ancestor.parent;
+                            layer--;
+                        }
+                    }
+                }
+            }
+            expanded += localExpanded;
+        });
+
+        std::vector<Node> next;
+        for (auto& part : produced) {
+            next.insert(next.end(), part.begin(), part.end());
+        }
+        layers.push_back(std::move(next));
+        result.layers = depth + 1;
+        result.statesKept += layers.back().size();
+
+        // Collect wins and scores reached on this turn
+        const std::vector<Node>& reached = layers.back();
+        for (uint32_t i = 0; i < reached.size(); i++) {
+            const GameState& state = reached[i].state;
+            result.bestScore = std::max(result.bestScore, static_cast<int>(state.score));
+            if (!state.hasFlag(FLAG_ESCAPED)) {
+                continue;
+            }
+            if (!result.winnable || (result.shortestWin.size() == layers.size() - 1 &&
+                                     state.score > result.shortestWinScore)) {
+                result.shortestWin = pathTo(layers, layers.size() - 1, i, actions);
+                result.shortestWinScore = state.score;
+            }
+            if (!result.winnable || state.score > result.bestWinScore) {
+                result.bestWin = pathTo(layers, layers.size() - 1, i, actions);
+                result.bestWinScore = state.score;
+            }
+            result.winnable = true;
+        }
+
+        if (result.statesKept >= options.maxStates) {
+            break;
+        }
+    }
+
+    bool frontierLeft = false;
+    for (const Node& node : layers.back()) {
+        frontierLeft = frontierLeft || node.state.hasFlag(FLAG_RUNNING);
+    }
+    result.truncated = frontierLeft;
+    result.statesExpanded = expanded;
+    return true;
+}
@@ -0,0 +1,98 @@
+// thread_pool.cpp - Implementation of the ThreadPool class
+
+#include "../include/thread_pool.h"
+#include <algorithm>
+
+// Start the worker threads
+ThreadPool::ThreadPool(unsigned threadCount) :
+    task(nullptr),
+    jobSize(0),
+    chunkSize(1),
+    nextIndex(0),
+    activeWorkers(0),
+    generation(0),
+    stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    // The caller of parallelFor is worker 0
+    for (unsigned i = 1; i < threadCount; i++) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+// Stop and join the worker threads
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Run a parallel loop and wait until every chunk has finished
+void ThreadPool::parallelFor(size_t count, size_t chunk, const RangeTask& rangeTask) {
+    if (count == 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        task = &rangeTask;
+        jobSize = count;
+        chunkSize = std::max<size_t>(1, chunk);
+        nextIndex = 0;
+        activeWorkers = static_cast<unsigned>(threads.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return activeWorkers == 0; });
+    task = nullptr;
+}
+
+// Wait for jobs and help run them
+void ThreadPool::workerLoop(unsigned worker) {
+    unsigned long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+        }
+
+        runChunks(worker);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeWorkers == 0) {
+            done.notify_all();
+        }
+    }
+}
+
+// Claim chunks of the current job until none are left
+void ThreadPool::runChunks(unsigned worker) {
+    while (true) {
+        size_t begin;
+        size_t end;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (nextIndex >= jobSize) {
+                return;
+            }
+            begin = nextIndex;
+            end = std::min(jobSize, begin + chunkSize);
+            nextIndex = end;
+        }
+        (*task)(begin, end, worker);
+    }
+}
@@ -0,0 +1,193 @@
+// RoboQuest - A text-based adventure game in C++
+// timer_wheel.cpp - Implementation of the TimerWheel class
+
+#include "../include/timer_wheel.h"
+
+// Constructor
+TimerWheel::TimerWheel(uint64_t startTick) :
+    freeList(NIL),
+    currentTick(startTick),
+    active(0) {
+    for (uint32_t& head : buckets) {
+        head = NIL;
+    }
+}
+
+// File a node in the slot its deadline falls into, relative to now
+void TimerWheel::link(uint32_t index) {
+    Node& node = nodes[index];
+    uint32_t bucket;
+    if (node.deadline <= currentTick) {
+        bucket = static_cast<uint32_t>((currentTick + 1) & (SLOTS - 1));
+    } else {
+        uint64_t delta = node.deadline - currentTick;
+        int level = 0;
+        while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1)))) {
+            level++;
+        }
+        uint64_t slot = node.deadline >> (SLOT_BITS * level);
+        if (delta >= (uint64_t(1) << (SLOT_BITS * LEVELS))) {
+            // Beyond the wheel: park in the last slot of the top level and
+            // file again when it cascades
+            slot = (currentTick >> (SLOT_BITS * level)) + SLOTS - 1;
+        }
+        bucket = level * SLOTS + static_cast<uint32_t>(slot & (SLOTS - 1));
+    }
+    linkInto(index, bucket);
+}
+
+// Push a node onto the front of a slot list
+void TimerWheel::linkInto(uint32_t index, uint32_t bucket) {
+    Node& node = nodes[index];
+    node.bucket = bucket;
+    node.prev = NIL;
+    node.next = buckets[bucket];
+    if (node.next != NIL) {
+        nodes[node.next].prev = index;
+    }
+    buckets[bucket] = index;
+}
+
+// Remove a node from its slot list
+void TimerWheel::unlink(uint32_t index) {
+    Node& node = nodes[index];
+    if (node.prev != NIL) {
+        nodes[node.prev].next = node.next;
+    } else {
+        buckets[node.bucket] = node.next;
+    }
+    if (node.next != NIL) {
+        nodes[node.next].prev = node.prev;
+    }
+}
+
+// Return a node to the free list; its old handle stops matching
+void TimerWheel::release(uint32_t index) {
+    Node& node = nodes[index];
+    node.bucket = NIL;
+    node.generation = node.generation == UINT32_MAX ? 1 : node.generation + 1;
+    node.next = freeList;
+    freeList = index;
+    active--;
+}
+
+// Resolve a handle to a pending node
+bool TimerWheel::lookup(TimerHandle handle, uint32_t& index) const {
+    uint32_t slot = static_cast<uint32_t>(handle & UINT32_MAX);
+    uint32_t generation = static_cast<uint32_t>(handle >> 32);
+    if (slot == 0 || slot > nodes.size()) {
+        return false;
+    }
+    index = slot - 1;
+    return nodes[index].bucket != NIL && nodes[index].generation == generation;
+}
+
+// Refile every timer in the current slot of a higher level. This runs
+// before the current level 0 slot is processed, so timers due right now
+// go into that slot rather than the next one.
+void TimerWheel::cascade(int level) {
+    uint32_t bucket = level * SLOTS +
+                      static_cast<uint32_t>((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+    uint32_t index = buckets[bucket];
+    buckets[bucket] = NIL;
+    while (index != NIL) {
+        uint32_t next = nodes[index].next;
+        if (nodes[index].deadline <= currentTick) {
+            linkInto(index, static_cast<uint32_t>(currentTick & (SLOTS - 1)));
+        } else {
+            link(index);
+        }
+        index = next;
+    }
+}
+
+TimerHandle TimerWheel::schedule(uint64_t deadline, uint64_t userData) {
+    uint32_t index;
+    if (freeList != NIL) {
+        index = freeList;
+        freeList = nodes[index].next;
+    } else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node());
+        nodes[index].generation = 1;
+    }
+
+    Node& node = nodes[index];
+    node.deadline = deadline;
+    node.userData = userData;
+    link(index);
+    active++;
+    return (static_cast<uint64_t>(node.generation) << 32) | (index + 1);
+}
+
+bool TimerWheel::cancel(TimerHandle handle) {
+    uint32_t index;
+    if (!lookup(handle, index)) {
+        return false;
+    }
+    unlink(index);
+    release(index);
+    return true;
+}
+
+// Later deadlines are picked up lazily when the timer's slot comes round;
+// earlier ones are refiled now so they cannot fire late
+bool TimerWheel::extend(TimerHandle handle, int64_t ticks) {
+    uint32_t index;
+    if (!lookup(handle, index)) {
+        return false;
+    }
+    Node& node = nodes[index];
+    if (ticks >= 0) {
+        node.deadline += static_cast<uint64_t>(ticks);
+    } else {
+        uint64_t shorten = static_cast<uint64_t>(-ticks);
+        node.deadline = node.deadline > shorten ? node.deadline - shorten : 0;
+        unlink(index);
+        link(index);
+    }
+    return true;
+}
+
+bool TimerWheel::deadline(TimerHandle handle, uint64_t& tick) const {
+    uint32_t index;
+    if (!lookup(handle, index)) {
+        return false;
+    }
+    tick = nodes[index].deadline;
+    return true;
+}
+
+size_t TimerWheel::advance(uint64_t tick, std::vector<uint64_t>& expired) {
+    size_t fired = 0;
+    while (currentTick < tick) {
+        if (active == 0) {
+            currentTick = tick;
+            break;
+        }
+        currentTick++;
+
+        // When a level wraps, bring the next slot of the level above down
+        uint32_t slot = static_cast<uint32_t>(currentTick & (SLOTS - 1));
+        for (int level = 1; slot == 0 && level < LEVELS; level++) {
+            cascade(level);
+            slot = static_cast<uint32_t>((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+        }
+
+        uint32_t bucket = static_cast<uint32_t>(currentTick & (SLOTS - 1));
+        uint32_t index = buckets[bucket];
+        buckets[bucket] = NIL;
+        while (index != NIL) {
+            uint32_t next = nodes[index].next;
+            if (nodes[index].deadline <= currentTick) {
+                expired.push_back(nodes[index].userData);
+                release(index);
+                fired++;
+            } else {
+                link(index); // extended since it was filed
+            }
+            index = next;
+        }
+    }
+    return fired;
+}
@@ -0,0 +1,251 @@
+// RoboQuest - A text-based adventure game in C++
+// turn_scheduler.cpp - Implementation of the TurnScheduler class
+
+#include "../include/turn_scheduler.h"
+#include <algorithm>
+
+namespace {
+
+// Count on a single writer without a locked instruction
+void bump(std::atomic<uint64_t>& counter, uint64_t amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+} // namespace
+
+// Turns waiting for one session. scheduled is set while the session is in
+// a ready queue or running, so at most one worker ever holds it.
+class TurnScheduler::Session {
+public:
+    std::mutex mutex;
+    std::deque<Turn> turns;
+    bool scheduled = false;
+    unsigned home = 0; // worker that ran it last
+};
+
+// A thread and its ready queue; the owner takes from the front and
+// thieves from the back
+struct alignas(64) TurnScheduler::Worker {
+    std::mutex mutex;
+    std::deque<Session*> ready;
+    std::thread thread;
+    uint64_t victimSeed;
+
+    std::atomic<uint64_t> turns{0};
+    std::atomic<uint64_t> steals{0};
+    std::atomic<uint64_t> homeRuns{0};
+    std::atomic<uint64_t> dispatches{0};
+};
+
+// Start the worker threads
+TurnScheduler::TurnScheduler(unsigned threadCount) :
+    nextHome(0),
+    queued(0),
+    sleeping(0),
+    stopping(false),
+    outstanding(0) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        workers.emplace_back(new Worker());
+        workers.back()->victimSeed = 0x9E3779B97F4A7C15ull * (i + 1);
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        workers[i]->thread = std::thread(&TurnScheduler::workerLoop, this, i);
+    }
+}
+
+// Stop and join the worker threads; turns still queued are dropped
+TurnScheduler::~TurnScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        stopping = true;
+    }
+    idle.notify_all();
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+}
+
+TurnScheduler::Session& TurnScheduler::addSession() {
+    std::unique_ptr<Session> session(new Session());
+    session->home = nextHome.fetch_add(1, std::memory_order_relaxed) % size();
+    std::lock_guard<std::mutex> lock(sessionsMutex);
+    sessions.push_back(std::move(session));
+    return *sessions.back();
+}
+
+void TurnScheduler::submit(Session& session, Turn turn) {
+    unsigned home;
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        session.turns.push_back(std::move(turn));
+        if (session.scheduled) {
+            return; // its worker picks the turn up after the current one
+        }
+        session.scheduled = true;
+        home = session.home;
+    }
+    outstanding.fetch_add(1);
+    makeReady(session, home);
+}
+
+// Put a session on a worker's ready queue and wake a sleeper for it
+void TurnScheduler::makeReady(Session& session, unsigned worker) {
+    {
+        std::lock_guard<std::mutex> lock(workers[worker]->mutex);
+        workers[worker]->ready.push_back(&session);
+    }
+    // A worker going to sleep announces itself before its last look at
+    // queued, so either it sees this session or we see it asleep
+    queued.fetch_add(1);
+    if (sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(idleMutex);
+        idle.notify_one();
+    }
+}
+
+TurnScheduler::Session* TurnScheduler::takeOwn(Worker& worker) {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (worker.ready.empty()) {
+        return nullptr;
+    }
+    Session* session = worker.ready.front();
+    worker.ready.pop_front();
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    return session;
+}
+
+// Take half of another worker's queue, starting from a random victim.
+// One session runs now and the rest move to the thief's queue.
+TurnScheduler::Session* TurnScheduler::steal(unsigned thief) {
+    Worker& own = *workers[thief];
+    unsigned count = size();
+    own.victimSeed = own.victimSeed * 6364136223846793005ull + 1442695040888963407ull;
+    unsigned first = static_cast<unsigned>(own.victimSeed >> 33) % count;
+
+    for (unsigned i = 0; i < count; i++) {
+        unsigned victimIndex = (first + i) % count;
+        if (victimIndex == thief) {
+            continue;
+        }
+        Worker& victim = *workers[victimIndex];
+        std::vector<Session*> taken;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            size_t half = (victim.ready.size() + 1) / 2;
+            for (size_t n = 0; n < half; n++) {
+                taken.push_back(victim.ready.back());
+                victim.ready.pop_back();
+            }
+        }
+        if (taken.empty()) {
+            continue;
+        }
+
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        if (taken.size() > 1) {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.ready.insert(own.ready.end(), taken.begin() + 1, taken.end());
+        }
+        bump(own.steals, taken.size());
+        return taken.front();
+    }
+    return nullptr;
+}
+
+// Run a few turns of one session, then requeue it if it has more
+void TurnScheduler::dispatch(Worker& worker, Session& session) {
+    unsigned index = static_cast<unsigned>(&worker - workers[0].get());
+    bump(worker.dispatches);
+    {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        if (session.home == index) {
+            bump(worker.homeRuns);
+        }
+        session.home = index;
+    }
+
+    // Once released, a submit from another thread may queue it again
+    bool released = false;
+    for (unsigned n = 0; n < TURNS_PER_DISPATCH && !released; n++) {
+        Turn turn;
+        {
+            std::lock_guard<std::mutex> lock(session.mutex);
+            if (session.turns.empty()) {
+                session.scheduled = false;
+                released = true;
+                break;
+            }
+            turn = std::move(session.turns.front());
+            session.turns.pop_front();
+        }
+        turn();
+        bump(worker.turns);
+    }
+    if (!released) {
+        std::lock_guard<std::mutex> lock(session.mutex);
+        if (session.turns.empty()) {
+            session.scheduled = false;
+            released = true;
+        }
+    }
+
+    if (!released) {
+        // Back of our own queue, behind the sessions that were waiting;
+        // idle workers may come and steal it
+        size_t waiting;
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.ready.push_back(&session);
+            waiting = worker.ready.size();
+        }
+        queued.fetch_add(1);
+        if (waiting > 1 && sleeping.load() > 0) {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            idle.notify_one();
+        }
+    } else if (outstanding.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(drainMutex);
+        drained.notify_all();
+    }
+}
+
+void TurnScheduler::workerLoop(unsigned index) {
+    Worker& worker = *workers[index];
+    while (true) {
+        Session* session = takeOwn(worker);
+        if (session == nullptr) {
+            session = steal(index);
+        }
+        if (session != nullptr) {
+            dispatch(worker, *session);
+            continue;
+        }
+
+        sleeping.fetch_add(1);
+        std::unique_lock<std::mutex> lock(idleMutex);
+        idle.wait(lock, [this] { return stopping || queued.load() > 0; });
+        sleeping.fetch_sub(1);
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void TurnScheduler::wait() {
+    std::unique_lock<std::mutex> lock(drainMutex);
+    drained.wait(lock, [this] { return outstanding.load() == 0; });
+}
+
+SchedulerStats TurnScheduler::stats() const {
+    SchedulerStats total = {0, 0, 0, 0};
+    for (const auto& worker : workers) {
+        total.turns += worker->turns.load(std::memory_order_relaxed);
+        total.steals += worker->steals.load(std::memory_order_relaxed);
+        total.homeRuns += worker->homeRuns.load(std::memory_order_relaxed);
+        total.dispatches += worker->dispatches.load(std::memory_order_relaxed);
+    }
+    return total;
+}
@@ -0,0 +1,155 @@
+// world.cpp - Implementation of the World class
+
+#include "../include/world.h"
+#include "../include/world_compiler.h"
+#include "../include/name_hash.h"
+
+namespace {
+
+// True if [offset, offset + count * recordSize) lies inside the image
+bool sectionFits(uint32_t offset, uint64_t count, size_t recordSize, size_t imageSize) {
+    return offset <= imageSize && count <= (imageSize - offset) / recordSize;
+}
+
+// Cells of a dense grid, or slots of a hashed one
+uint64_t gridCells(const WorldImageHeader& header) {
+    if (header.gridHashSlots != 0) {
+        return header.gridHashSlots;
+    }
+    return static_cast<uint64_t>(header.gridWidth) * header.gridHeight;
+}
+
+} // namespace
+
+// Constructor
+World::World() :
+    base(nullptr),
+    header(nullptr),
+    rooms(nullptr),
+    grid(nullptr),
+    items(nullptr),
+    rules(nullptr),
+    scripts(nullptr),
+    code(nullptr),
+    constants(nullptr),
+    scriptStrings(nullptr),
+    itemSlots(nullptr) {
+}
+
+// Map a compiled world image
+bool World::loadImage(const std::string& path, std::string& error) {
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+    if (!attach(file.data(), file.size(), error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    mapping = std::move(file);
+    ownedImage.clear();
+    return true;
+}
+
+// Compile a world source file into memory
+bool World::loadSource(const std::string& path, std::string& error) {
+    WorldCompiler compiler;
+    std::vector<char> image;
+    if (!compiler.compileFile(path, image)) {
+        error = compiler.lastError();
+        return false;
+    }
+    return loadBuffer(std::move(image), error);
+}
+
+// Take ownership of an image already in memory
+bool World::loadBuffer(std::vector<char> image, std::string& error) {
+    if (!attach(image.data(), image.size(), error)) {
+        return false;
+    }
+    // Moving the vector keeps its heap block, so the attached pointers stay valid
+    ownedImage = std::move(image);
+    mapping.close();
+    return true;
+}
+
+// Validate the header and point the section views into the image. Only the
+// header is checked, so attaching costs the same regardless of world size.
+bool World::attach(const char* data, size_t size, std::string& error) {
+    if (size < sizeof(WorldImageHeader)) {
+        error = "world image is truncated";
+        return false;
+    }
+
+    const WorldImageHeader* candidate = reinterpret_cast<const WorldImageHeader*>(data);
+    if (candidate->magic != WORLD_IMAGE_MAGIC) {
+        error = "not a RoboQuest world image";
+        return false;
+    }
+    if (candidate->version != WORLD_IMAGE_VERSION) {
+        error = "world image version " + std::to_string(candidate->version) +
+                " is not supported (expected " + std::to_string(WORLD_IMAGE_VERSION) + ")";
+        return false;
+    }
+    if (candidate->imageSize != size ||
+        !sectionFits(candidate->roomOffset, candidate->roomCount, sizeof(WorldRoomRecord), size) ||
+        !sectionFits(candidate->gridOffset, gridCells(*candidate), sizeof(int32_t), size) ||
+        (candidate->gridHashSlots & (candidate->gridHashSlots - 1)) != 0 ||
+        !sectionFits(candidate->itemOffset, candidate->itemCount, sizeof(WorldItemRecord), size) ||
+        !sectionFits(candidate->ruleOffset, candidate->ruleCount, sizeof(WorldRuleRecord), size) ||
+        !sectionFits(candidate->scriptOffset, candidate->scriptCount, sizeof(WorldScriptRecord), size) ||
+        !sectionFits(candidate->scriptCodeOffset, candidate->scriptCodeSize, sizeof(uint32_t), size) ||
+        !sectionFits(candidate->scriptConstantOffset, candidate->scriptConstantCount, sizeof(int32_t), size) ||
+        !sectionFits(candidate->scriptStringOffset, candidate->scriptStringCount, sizeof(WorldString), size) ||
+        !sectionFits(candidate->itemHashOffset, candidate->itemHashSlots, sizeof(int32_t), size) ||
+        candidate->itemHashSlots == 0 || (candidate->itemHashSlots & (candidate->itemHashSlots - 1)) != 0 ||
+        candidate->roomCount == 0 ||
+        candidate->startRoom < 0 || candidate->startRoom >= static_cast<int32_t>(candidate->roomCount)) {
+        error = "world image is corrupt";
+        return false;
+    }
+
+    base = data;
+    header = candidate;
+    rooms = reinterpret_cast<const WorldRoomRecord*>(data + header->roomOffset);
+    grid = reinterpret_cast<const int32_t*>(data + header->gridOffset);
+    items = reinterpret_cast<const WorldItemRecord*>(data + header->itemOffset);
+    rules = reinterpret_cast<const WorldRuleRecord*>(data + header->ruleOffset);
+    scripts = reinterpret_cast<const WorldScriptRecord*>(data + header->scriptOffset);
+    code = reinterpret_cast<const uint32_t*>(data + header->scriptCodeOffset);
+    constants = reinterpret_cast<const int32_t*>(data + header->scriptConstantOffset);
+    scriptStrings = reinterpret_cast<const WorldString*>(data + header->scriptStringOffset);
+    itemSlots = reinterpret_cast<const int32_t*>(data + header->itemHashOffset);
+    return true;
+}
+
+// Find the room at the given coordinates
+int World::findRoom(int x, int y) const {
+    if (header->gridHashSlots != 0) {
+        uint32_t mask = header->gridHashSlots - 1;
+        uint32_t slot = roomCellHash(x, y) & mask;
+        for (uint32_t probes = 0; probes <= mask; probes++, slot = (slot + 1) & mask) {
+            int room = grid[slot];
+            if (room < 0 || room >= static_cast<int>(header->roomCount)) {
+                return RoomIndex::NO_ROOM;
+            }
+            if (rooms[room].x == x && rooms[room].y == y) {
+                return room;
+            }
+        }
+        return RoomIndex::NO_ROOM;
+    }
+    int64_t col = static_cast<int64_t>(x) - header->gridMinX;
+    int64_t row = static_cast<int64_t>(y) - header->gridMinY;
+    if (col < 0 || col >= header->gridWidth || row < 0 || row >= header->gridHeight) {
+        return RoomIndex::NO_ROOM;
+    }
+    int room = grid[row * header->gridWidth + col];
+    return room >= 0 && room < static_cast<int>(header->roomCount) ? room : RoomIndex::NO_ROOM;
+}
+
+// Find an item by key
+int World::findItem(std::string_view key) const {
+    int item = itemSlots[nameHash(key, header->itemHashSeed) & (header->itemHashSlots - 1)];
+    return item >= 0 && text(items[item].key) == key ? item : -1;
+}
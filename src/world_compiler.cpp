@@ -0,0 +1,656 @@
+// world_compiler.cpp - Implementation of the WorldCompiler class
+
+#include "../include/world_compiler.h"
+#include "../include/world.h"
+#include "../include/game_state.h"
+#include "../include/room_index.h"
+#include "../include/name_hash.h"
+#include <cassert>
+#include <cctype>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Remove leading and trailing whitespace (including a stray '\r')
+std::string trim(const std::string& text) {
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(text[begin]))) begin++;
+    while (end > begin && std::isspace(static_cast<unsigned char>(text[end - 1]))) end--;
+    return text.substr(begin, end - begin);
+}
+
+// Split "keyword rest of line" into its two parts
+void splitKeyword(const std::string& line, std::string& keyword, std::string& rest) {
+    size_t space = line.find_first_of(" \t");
+    if (space == std::string::npos) {
+        keyword = line;
+        rest.clear();
+    } else {
+        keyword = line.substr(0, space);
+        rest = trim(line.substr(space + 1));
+    }
+}
+
+bool parseInt(const std::string& text, int& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    long parsed = std::strtol(text.c_str(), &end, 10);
+    if (*end != '\0' || parsed < INT_MIN || parsed > INT_MAX) return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+int parseDirection(const std::string& word) {
+    if (word == "north") return NORTH;
+    if (word == "south") return SOUTH;
+    if (word == "east") return EAST;
+    if (word == "west") return WEST;
+    return -1;
+}
+
+std::string lowercase(std::string text) {
+    for (auto& c : text) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+// Appends records and strings and hands out image offsets
+class ImageWriter {
+public:
+    std::vector<char> bytes;
+
+    size_t reserve(size_t size) {
+        size_t offset = align(bytes.size());
+        bytes.resize(offset + size, 0);
+        return offset;
+    }
+
+    WorldString addString(const std::string& text) {
+        WorldString ref;
+        ref.offset = static_cast<uint32_t>(bytes.size());
+        ref.length = static_cast<uint32_t>(text.size());
+        bytes.insert(bytes.end(), text.begin(), text.end());
+        bytes.push_back('\0');
+        return ref;
+    }
+
+    template <typename T>
+    T* at(size_t offset) {
+        return reinterpret_cast<T*>(bytes.data() + offset);
+    }
+
+private:
+    static size_t align(size_t offset) {
+        return (offset + 7) & ~static_cast<size_t>(7);
+    }
+};
+
+} // namespace
+
+// Compile a world source file into an image
+bool WorldCompiler::compileFile(const std::string& path, std::vector<char>& image) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "Could not open world source " + path;
+        return false;
+    }
+    return compile(file, path, image);
+}
+
+// Compile source text into an image
+bool WorldCompiler::compile(std::istream& source, const std::string& name, std::vector<char>& image) {
+    sourceName = name;
+    startRoom.clear();
+    goalRoom.clear();
+    mapText.clear();
+    rooms.clear();
+    items.clear();
+    rules.clear();
+    scripts.clear();
+    events.clear();
+    flags.assign(1, "exit_unlocked");
+    error.clear();
+
+    return parse(source) && emit(image);
+}
+
+// Record an error with its source location
+bool WorldCompiler::fail(int line, const std::string& message) {
+    std::ostringstream oss;
+    oss << sourceName << ":" << line << ": " << message;
+    error = oss.str();
+    return false;
+}
+
+// Find a room by key
+int WorldCompiler::roomIndex(const std::string& key) const {
+    for (size_t i = 0; i < rooms.size(); i++) {
+        if (rooms[i].key == key) return static_cast<int>(i);
+    }
+    return RoomIndex::NO_ROOM;
+}
+
+// Find an item by key
+int WorldCompiler::itemIndex(const std::string& key) const {
+    for (size_t i = 0; i < items.size(); i++) {
+        if (items[i].key == key) return static_cast<int>(i);
+    }
+    return -1;
+}
+
+// Find a script by name
+int WorldCompiler::scriptIndex(const std::string& name) const {
+    for (size_t i = 0; i < scripts.size(); i++) {
+        if (scripts[i].name == name) return static_cast<int>(i);
+    }
+    return WORLD_NO_SCRIPT;
+}
+
+// Add world flags by name to a mask, giving new names the next free bit
+bool WorldCompiler::addFlags(int line, const std::string& names, uint32_t& mask) {
+    std::istringstream words(names);
+    std::string name;
+    bool any = false;
+    while (words >> name) {
+        size_t bit = 0;
+        while (bit < flags.size() && flags[bit] != name) bit++;
+        if (bit == flags.size()) {
+            if (flags.size() == static_cast<size_t>(WORLD_FLAG_COUNT)) {
+                return fail(line, "more than " + std::to_string(WORLD_FLAG_COUNT) + " flags");
+            }
+            flags.push_back(name);
+        }
+        mask |= 1u << bit;
+        any = true;
+    }
+    return any || fail(line, "expected at least one flag name");
+}
+
+// Turn a list of item keys into an item mask
+bool WorldCompiler::resolveItems(const RuleDef& rule, const std::vector<std::string>& keys, uint64_t* mask) {
+    for (const std::string& key : keys) {
+        int item = itemIndex(key);
+        if (item < 0) return fail(rule.line, "rule refers to unknown item '" + key + "'");
+        assert(item < WORLD_ITEM_LIMIT);
+        mask[item / 64] |= uint64_t(1) << (item % 64);
+    }
+    return true;
+}
+
+// Parse the text format into room, item and rule definitions
+bool WorldCompiler::parse(std::istream& source) {
+    enum class Block { NONE, ROOM, ITEM, RULE, SCRIPT, MAP };
+    Block block = Block::NONE;
+    int scriptDepth = 0; // ifs and whiles open in the current script
+
+    std::string raw;
+    int lineNumber = 0;
+    while (std::getline(source, raw)) {
+        lineNumber++;
+        if (!raw.empty() && raw.back() == '\r') raw.pop_back();
+
+        std::string line = trim(raw);
+
+        // Map lines are kept verbatim
+        if (block == Block::MAP) {
+            if (line == "end") {
+                block = Block::NONE;
+            } else {
+                mapText += raw;
+                mapText += '\n';
+            }
+            continue;
+        }
+
+        if (line.empty() || line[0] == '#') continue;
+
+        std::string keyword;
+        std::string rest;
+        splitKeyword(line, keyword, rest);
+
+        // Script lines are compiled later; only their nesting matters here
+        if (block == Block::SCRIPT && (keyword != "end" || scriptDepth > 0)) {
+            if (keyword == "if" || keyword == "while") scriptDepth++;
+            if (keyword == "end") scriptDepth--;
+            scripts.back().lines.push_back({line, lineNumber});
+            continue;
+        }
+
+        if (keyword == "end") {
+            if (block == Block::NONE) return fail(lineNumber, "'end' outside of a block");
+            block = Block::NONE;
+            continue;
+        }
+
+        switch (block) {
+            case Block::NONE: {
+                std::istringstream args(rest);
+                if (keyword == "room") {
+                    RoomDef room;
+                    std::string x, y;
+                    args >> room.key >> x >> y;
+                    if (room.key.empty() || !parseInt(x, room.x) || !parseInt(y, room.y)) {
+                        return fail(lineNumber, "expected 'room <key> <x> <y>'");
+                    }
+                    if (roomIndex(room.key) != RoomIndex::NO_ROOM) {
+                        return fail(lineNumber, "duplicate room '" + room.key + "'");
+                    }
+                    room.exitMask = -1;
+                    room.line = lineNumber;
+                    rooms.push_back(room);
+                    block = Block::ROOM;
+                } else if (keyword == "item") {
+                    ItemDef item;
+                    args >> item.key;
+                    if (item.key.empty()) return fail(lineNumber, "expected 'item <key>'");
+                    if (items.size() == static_cast<size_t>(WORLD_ITEM_LIMIT)) {
+                        return fail(lineNumber, "more than " + std::to_string(WORLD_ITEM_LIMIT) + " items");
+                    }
+                    for (const auto& other : items) {
+                        if (other.key == item.key) return fail(lineNumber, "duplicate item '" + item.key + "'");
+                    }
+                    item.score = 0;
+                    item.line = lineNumber;
+                    items.push_back(item);
+                    block = Block::ITEM;
+                } else if (keyword == "use" || keyword == "action") {
+                    RuleDef rule;
+                    if (keyword == "use") {
+                        std::string item;
+                        args >> item >> rule.room;
+                        if (item.empty() || rule.room.empty()) {
+                            return fail(lineNumber, "expected 'use <item> <room>'");
+                        }
+                        rule.command = "use " + item;
+                        rule.option = "Use " + item;
+                        rule.requiredItems.push_back(item);
+                    } else {
+                        args >> rule.room;
+                        std::getline(args, rule.command);
+                        rule.command = trim(rule.command);
+                        if (rule.room.empty() || rule.command.empty()) {
+                            return fail(lineNumber, "expected 'action <room> <command>'");
+                        }
+                        rule.option = rule.command;
+                    }
+                    rule.requiredFlags = 0;
+                    rule.forbiddenFlags = 0;
+                    rule.setFlags = 0;
+                    rule.clearedFlags = 0;
+                    rule.score = 0;
+                    rule.timeBonus = 0;
+                    rule.effects = 0;
+                    rule.line = lineNumber;
+                    rules.push_back(rule);
+                    block = Block::RULE;
+                } else if (keyword == "script") {
+                    ScriptDef script;
+                    args >> script.name;
+                    if (script.name.empty()) return fail(lineNumber, "expected 'script <name>'");
+                    if (scriptIndex(script.name) != WORLD_NO_SCRIPT) {
+                        return fail(lineNumber, "duplicate script '" + script.name + "'");
+                    }
+                    script.line = lineNumber;
+                    scripts.push_back(script);
+                    scriptDepth = 0;
+                    block = Block::SCRIPT;
+                } else if (keyword == "on") {
+                    EventDef event;
+                    std::string trigger;
+                    args >> trigger;
+                    if (trigger == "enter") args >> event.room;
+                    args >> event.script;
+                    if ((trigger != "turn" && trigger != "enter") || event.script.empty() ||
+                        (trigger == "enter" && event.room.empty())) {
+                        return fail(lineNumber, "expected 'on turn <script>' or 'on enter <room> <script>'");
+                    }
+                    event.line = lineNumber;
+                    events.push_back(event);
+                } else if (keyword == "map") {
+                    block = Block::MAP;
+                } else if (keyword == "start") {
+                    startRoom = rest;
+                } else if (keyword == "goal") {
+                    goalRoom = rest;
+                } else {
+                    return fail(lineNumber, "unknown keyword '" + keyword + "'");
+                }
+                break;
+            }
+
+            case Block::ROOM: {
+                RoomDef& room = rooms.back();
+                if (keyword == "name") {
+                    room.name = rest;
+                } else if (keyword == "desc") {
+                    room.description = rest;
+                } else if (keyword == "exits") {
+                    room.exitMask = 0;
+                    std::istringstream words(rest);
+                    std::string word;
+                    while (words >> word) {
+                        int direction = parseDirection(word);
+                        if (direction < 0) return fail(lineNumber, "unknown direction '" + word + "'");
+                        room.exitMask |= 1 << direction;
+                    }
+                } else {
+                    return fail(lineNumber, "unknown room field '" + keyword + "'");
+                }
+                break;
+            }
+
+            case Block::ITEM: {
+                ItemDef& item = items.back();
+                if (keyword == "name") {
+                    item.name = rest;
+                } else if (keyword == "info") {
+                    item.info = rest;
+                } else if (keyword == "room") {
+                    item.room = rest;
+                } else if (keyword == "look") {
+                    item.lookText = rest;
+                } else if (keyword == "take") {
+                    item.takeText = rest;
+                } else if (keyword == "option") {
+                    item.takeOption = rest;
+                } else if (keyword == "score") {
+                    if (!parseInt(rest, item.score)) return fail(lineNumber, "score must be an integer");
+                } else {
+                    return fail(lineNumber, "unknown item field '" + keyword + "'");
+                }
+                break;
+            }
+
+            case Block::RULE: {
+                RuleDef& rule = rules.back();
+                std::istringstream words(rest);
+                std::string word;
+                if (keyword == "option") {
+                    rule.option = rest;
+                } else if (keyword == "text") {
+                    if (!rule.text.empty()) rule.text += '\n';
+                    rule.text += rest;
+                } else if (keyword == "look") {
+                    rule.lookText = rest;
+                } else if (keyword == "requires") {
+                    while (words >> word) rule.requiredItems.push_back(word);
+                } else if (keyword == "forbids") {
+                    while (words >> word) rule.forbiddenItems.push_back(word);
+                } else if (keyword == "gives") {
+                    while (words >> word) rule.givenItems.push_back(word);
+                } else if (keyword == "consumes") {
+                    while (words >> word) rule.takenItems.push_back(word);
+                } else if (keyword == "if") {
+                    if (!addFlags(lineNumber, rest, rule.requiredFlags)) return false;
+                } else if (keyword == "unless") {
+                    if (!addFlags(lineNumber, rest, rule.forbiddenFlags)) return false;
+                } else if (keyword == "set") {
+                    if (!addFlags(lineNumber, rest, rule.setFlags)) return false;
+                } else if (keyword == "clear") {
+                    if (!addFlags(lineNumber, rest, rule.clearedFlags)) return false;
+                } else if (keyword == "score") {
+                    if (!parseInt(rest, rule.score)) return fail(lineNumber, "score must be an integer");
+                } else if (keyword == "time") {
+                    if (!parseInt(rest, rule.timeBonus)) return fail(lineNumber, "time must be an integer");
+                    if (rule.timeBonus < -MAX_TIME_REMAINING || rule.timeBonus > MAX_TIME_REMAINING) {
+                        return fail(lineNumber, "time must be within " + std::to_string(MAX_TIME_REMAINING) + " seconds");
+                    }
+                } else if (keyword == "unlock") {
+                    rule.setFlags |= WORLD_FLAG_EXIT_UNLOCKED;
+                } else if (keyword == "map") {
+                    rule.effects |= RULE_SHOW_MAP;
+                } else if (keyword == "run") {
+                    rule.script = rest;
+                } else {
+                    return fail(lineNumber, "unknown rule field '" + keyword + "'");
+                }
+                break;
+            }
+
+            case Block::SCRIPT:
+            case Block::MAP:
+                break;
+        }
+    }
+
+    if (block != Block::NONE) return fail(lineNumber, "missing 'end'");
+    if (rooms.empty()) return fail(lineNumber, "world has no rooms");
+    return true;
+}
+
+// Resolve references and lay out the binary image
+bool WorldCompiler::emit(std::vector<char>& image) {
+    // Resolve the grid and neighbors
+    RoomIndex index;
+    for (const auto& room : rooms) {
+        index.addRoom(room.x, room.y, room.description);
+    }
+    index.build();
+    
+    // A later room in the same cell replaces the earlier one in the grid
+    for (size_t i = 0; i < rooms.size(); i++) {
+        if (index.find(rooms[i].x, rooms[i].y) != static_cast<int>(i)) {
+            return fail(rooms[i].line, "room '" + rooms[i].key + "' overlaps another room");
+        }
+    }
+
+    int start = startRoom.empty() ? 0 : roomIndex(startRoom);
+    if (start == RoomIndex::NO_ROOM) return fail(0, "unknown start room '" + startRoom + "'");
+    int goal = goalRoom.empty() ? RoomIndex::NO_ROOM : roomIndex(goalRoom);
+    if (!goalRoom.empty() && goal == RoomIndex::NO_ROOM) return fail(0, "unknown goal room '" + goalRoom + "'");
+
+    // Compile the scripts, which may name items, rooms, flags and counters
+    ScriptNames names;
+    for (const auto& item : items) names.items.push_back(item.key);
+    for (const auto& room : rooms) names.rooms.push_back(room.key);
+    names.flags = flags;
+    ScriptCompiler scriptCompiler;
+    std::vector<uint32_t> scriptStarts;
+    for (const ScriptDef& def : scripts) {
+        uint32_t codeStart = 0;
+        if (!scriptCompiler.compile(def.lines, names, codeStart)) {
+            int line = scriptCompiler.errorLineNumber() > 0 ? scriptCompiler.errorLineNumber() : def.line;
+            return fail(line, scriptCompiler.lastError());
+        }
+        scriptStarts.push_back(codeStart);
+    }
+    scriptStarts.push_back(static_cast<uint32_t>(scriptCompiler.code.size()));
+
+    // At most one script for every turn and one for entering each room
+    int32_t turnScript = WORLD_NO_SCRIPT;
+    std::vector<int32_t> enterScripts(rooms.size(), WORLD_NO_SCRIPT);
+    for (const EventDef& event : events) {
+        int script = scriptIndex(event.script);
+        if (script == WORLD_NO_SCRIPT) return fail(event.line, "unknown script '" + event.script + "'");
+        int room = event.room.empty() ? RoomIndex::NO_ROOM : roomIndex(event.room);
+        if (!event.room.empty() && room == RoomIndex::NO_ROOM) {
+            return fail(event.line, "unknown room '" + event.room + "'");
+        }
+        int32_t& slot = event.room.empty() ? turnScript : enterScripts[room];
+        if (slot != WORLD_NO_SCRIPT) return fail(event.line, "event already has a script");
+        slot = script;
+    }
+
+    // Perfect hash for item keys: table at least twice the item count,
+    // trying seeds until every key lands in its own slot
+    uint32_t hashSlots = 1;
+    while (hashSlots < items.size() * 2) hashSlots <<= 1;
+    uint32_t hashSeed = 0;
+    std::vector<int32_t> slots;
+    for (uint32_t seed = 1; hashSeed == 0; seed++) {
+        if (seed > 100000) {
+            hashSlots <<= 1;
+            seed = 1;
+        }
+        slots.assign(hashSlots, -1);
+        bool collision = false;
+        for (size_t i = 0; i < items.size() && !collision; i++) {
+            uint32_t slot = nameHash(items[i].key, seed) & (hashSlots - 1);
+            collision = slots[slot] >= 0;
+            slots[slot] = static_cast<int32_t>(i);
+        }
+        if (!collision) hashSeed = seed;
+    }
+
+    ImageWriter writer;
+    size_t headerOffset = writer.reserve(sizeof(WorldImageHeader));
+    size_t roomOffset = writer.reserve(sizeof(WorldRoomRecord) * rooms.size());
+    size_t gridOffset = writer.reserve(sizeof(int32_t) * index.gridCellCount());
+    size_t itemOffset = writer.reserve(sizeof(WorldItemRecord) * items.size());
+    // Every placed item gets a take rule ahead of the use and action rules
+    size_t takeCount = 0;
+    for (const auto& item : items) {
+        if (!item.room.empty()) takeCount++;
+    }
+    size_t ruleCount = takeCount + rules.size();
+    size_t ruleOffset = writer.reserve(sizeof(WorldRuleRecord) * ruleCount);
+    size_t scriptOffset = writer.reserve(sizeof(WorldScriptRecord) * scripts.size());
+    size_t codeOffset = writer.reserve(sizeof(uint32_t) * scriptCompiler.code.size());
+    size_t constantOffset = writer.reserve(sizeof(int32_t) * scriptCompiler.constants.size());
+    size_t scriptStringOffset = writer.reserve(sizeof(WorldString) * scriptCompiler.strings.size());
+    size_t itemHashOffset = writer.reserve(sizeof(int32_t) * hashSlots);
+    for (uint32_t slot = 0; slot < hashSlots; slot++) {
+        *writer.at<int32_t>(itemHashOffset + slot * sizeof(int32_t)) = slots[slot];
+    }
+
+    for (size_t i = 0; i < rooms.size(); i++) {
+        const RoomDef& def = rooms[i];
+        WorldRoomRecord record;
+        record.x = def.x;
+        record.y = def.y;
+        for (int d = 0; d < DIRECTION_COUNT; d++) {
+            int target = index.neighbor(static_cast<int>(i), static_cast<Direction>(d));
+            bool open = def.exitMask < 0 || (def.exitMask & (1 << d)) != 0;
+            record.neighbors[d] = open ? target : RoomIndex::NO_ROOM;
+        }
+        record.key = writer.addString(def.key);
+        record.name = writer.addString(def.name.empty() ? def.key : def.name);
+        record.description = writer.addString(def.description);
+        record.enterScript = enterScripts[i];
+        *writer.at<WorldRoomRecord>(roomOffset + i * sizeof(WorldRoomRecord)) = record;
+    }
+
+    for (int cell = 0; cell < index.gridCellCount(); cell++) {
+        *writer.at<int32_t>(gridOffset + cell * sizeof(int32_t)) = index.gridCell(cell);
+    }
+
+    size_t ruleSlot = 0;
+    for (size_t i = 0; i < items.size(); i++) {
+        const ItemDef& def = items[i];
+        WorldItemRecord record;
+        record.room = def.room.empty() ? RoomIndex::NO_ROOM : roomIndex(def.room);
+        if (!def.room.empty() && record.room == RoomIndex::NO_ROOM) {
+            return fail(def.line, "item '" + def.key + "' placed in unknown room '" + def.room + "'");
+        }
+        std::string name = def.name.empty() ? def.key : def.name;
+        record.key = writer.addString(def.key);
+        record.name = writer.addString(name);
+        record.info = writer.addString(def.info);
+        *writer.at<WorldItemRecord>(itemOffset + i * sizeof(WorldItemRecord)) = record;
+
+        if (record.room == RoomIndex::NO_ROOM) continue;
+        WorldRuleRecord take;
+        std::memset(&take, 0, sizeof(take));
+        take.forbiddenItems[i / 64] = uint64_t(1) << (i % 64);
+        take.givenItems[i / 64] = uint64_t(1) << (i % 64);
+        take.room = record.room;
+        take.command = writer.addString("take " + def.key);
+        take.option = writer.addString(def.takeOption.empty() ? "Take " + lowercase(name) : def.takeOption);
+        take.text = writer.addString(def.takeText);
+        take.lookText = writer.addString(def.lookText);
+        take.score = def.score;
+        take.script = WORLD_NO_SCRIPT;
+        *writer.at<WorldRuleRecord>(ruleOffset + ruleSlot++ * sizeof(WorldRuleRecord)) = take;
+    }
+
+    for (const RuleDef& def : rules) {
+        WorldRuleRecord record;
+        std::memset(&record, 0, sizeof(record));
+        if (!resolveItems(def, def.requiredItems, record.requiredItems) ||
+            !resolveItems(def, def.forbiddenItems, record.forbiddenItems) ||
+            !resolveItems(def, def.givenItems, record.givenItems) ||
+            !resolveItems(def, def.takenItems, record.takenItems)) {
+            return false;
+        }
+        record.room = roomIndex(def.room);
+        if (record.room == RoomIndex::NO_ROOM) return fail(def.line, "rule in unknown room '" + def.room + "'");
+        record.command = writer.addString(def.command);
+        record.option = writer.addString(def.option);
+        record.text = writer.addString(def.text);
+        record.lookText = writer.addString(def.lookText);
+        record.requiredFlags = def.requiredFlags;
+        record.forbiddenFlags = def.forbiddenFlags;
+        record.setFlags = def.setFlags;
+        record.clearedFlags = def.clearedFlags;
+        record.score = def.score;
+        record.timeBonus = def.timeBonus;
+        record.effects = def.effects;
+        record.script = def.script.empty() ? WORLD_NO_SCRIPT : scriptIndex(def.script);
+        if (!def.script.empty() && record.script == WORLD_NO_SCRIPT) {
+            return fail(def.line, "unknown script '" + def.script + "'");
+        }
+        *writer.at<WorldRuleRecord>(ruleOffset + ruleSlot++ * sizeof(WorldRuleRecord)) = record;
+    }
+
+    for (size_t i = 0; i < scripts.size(); i++) {
+        WorldScriptRecord record;
+        record.name = writer.addString(scripts[i].name);
+        record.codeStart = scriptStarts[i];
+        record.codeLength = scriptStarts[i + 1] - scriptStarts[i];
+        *writer.at<WorldScriptRecord>(scriptOffset + i * sizeof(WorldScriptRecord)) = record;
+    }
+    for (size_t i = 0; i < scriptCompiler.code.size(); i++) {
+        *writer.at<uint32_t>(codeOffset + i * sizeof(uint32_t)) = scriptCompiler.code[i];
+    }
+    for (size_t i = 0; i < scriptCompiler.constants.size(); i++) {
+        *writer.at<int32_t>(constantOffset + i * sizeof(int32_t)) = scriptCompiler.constants[i];
+    }
+    for (size_t i = 0; i < scriptCompiler.strings.size(); i++) {
+        WorldString text = writer.addString(scriptCompiler.strings[i]);
+        *writer.at<WorldString>(scriptStringOffset + i * sizeof(WorldString)) = text;
+    }
+
+    WorldImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = WORLD_IMAGE_MAGIC;
+    header.version = WORLD_IMAGE_VERSION;
+    header.roomCount = static_cast<uint32_t>(rooms.size());
+    header.roomOffset = static_cast<uint32_t>(roomOffset);
+    header.gridMinX = index.gridMinX();
+    header.gridMinY = index.gridMinY();
+    header.gridWidth = static_cast<uint32_t>(index.gridWidth());
+    header.gridHeight = static_cast<uint32_t>(index.gridHeight());
+    header.gridHashSlots = index.gridHashed() ? static_cast<uint32_t>(index.gridCellCount()) : 0;
+    header.gridOffset = static_cast<uint32_t>(gridOffset);
+    header.itemCount = static_cast<uint32_t>(items.size());
+    header.itemOffset = static_cast<uint32_t>(itemOffset);
+    header.ruleCount = static_cast<uint32_t>(ruleCount);
+    header.ruleOffset = static_cast<uint32_t>(ruleOffset);
+    header.scriptCount = static_cast<uint32_t>(scripts.size());
+    header.scriptOffset = static_cast<uint32_t>(scriptOffset);
+    header.scriptCodeSize = static_cast<uint32_t>(scriptCompiler.code.size());
+    header.scriptCodeOffset = static_cast<uint32_t>(codeOffset);
+    header.scriptConstantCount = static_cast<uint32_t>(scriptCompiler.constants.size());
+    header.scriptConstantOffset = static_cast<uint32_t>(constantOffset);
+    header.scriptStringCount = static_cast<uint32_t>(scriptCompiler.strings.size());
+    header.scriptStringOffset = static_cast<uint32_t>(scriptStringOffset);
+    header.turnScript = turnScript;
+    header.itemHashSeed = hashSeed;
+    header.itemHashSlots = hashSlots;
+    header.itemHashOffset = static_cast<uint32_t>(itemHashOffset);
+    header.startRoom = start;
+    header.goalRoom = goal;
+    header.mapText = writer.addString(mapText);
+    header.imageSize = static_cast<uint32_t>(writer.bytes.size());
+    *writer.at<WorldImageHeader>(headerOffset) = header;
+    std::string_view bytes(writer.bytes.data(), writer.bytes.size());
+    writer.at<WorldImageHeader>(headerOffset)->fingerprint = nameHash(bytes, WORLD_IMAGE_MAGIC);
+
+    image.swap(writer.bytes);
+    return true;
+}
@@ -0,0 +1,52 @@
+// RoboQuest - A text-based adventure game in C++
+// world_publisher.cpp - Implementation of the WorldPublisher class
+
+#include "../include/world_publisher.h"
+#include "../include/mapped_file.h"
+
+// Constructor
+WorldPublisher::WorldPublisher(const std::string& image, const std::string& source) :
+    imagePath(image),
+    sourcePath(source),
+    publishedVersion(0) {
+}
+
+bool WorldPublisher::reloadImage(std::string& error) {
+    std::string imageError;
+    std::shared_ptr<const GameWorld> loaded;
+    MappedFile file;
+    if (file.open(imagePath, imageError)) {
+        loaded = GameWorld::fromImage(std::vector<char>(file.data(), file.data() + file.size()), imageError);
+        if (!loaded) {
+            imageError = imagePath + ": " + imageError;
+        }
+    }
+    if (!loaded) {
+        std::string sourceError;
+        loaded = GameWorld::compile(sourcePath, sourceError);
+        if (!loaded) {
+            error = imageError + "\n" + sourceError;
+            return false;
+        }
+    }
+    publish(std::move(loaded));
+    return true;
+}
+
+bool WorldPublisher::reloadSource(std::string& error) {
+    std::shared_ptr<const GameWorld> loaded = GameWorld::compile(sourcePath, error);
+    if (!loaded) {
+        return false;
+    }
+    publish(std::move(loaded));
+    return true;
+}
+
+void WorldPublisher::publish(std::shared_ptr<const GameWorld> world) {
+    std::shared_ptr<const GameWorld> previous = current();
+    if (previous && world && previous->world.fingerprint() == world->world.fingerprint()) {
+        return; // nothing changed, e.g. a second event for the same write
+    }
+    published.store(std::move(world), std::memory_order_release);
+    publishedVersion.fetch_add(1, std::memory_order_acq_rel);
+}
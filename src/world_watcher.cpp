@@ -0,0 +1,87 @@
+// RoboQuest - A text-based adventure game in C++
+// world_watcher.cpp - Implementation of the WorldWatcher class
+
+#include "../include/world_watcher.h"
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace {
+
+// A file was finished or renamed into place
+const uint32_t WORLD_FILE_EVENTS = IN_CLOSE_WRITE | IN_MOVED_TO;
+
+std::string directoryOf(const std::string& path) {
+    std::string parent = std::filesystem::path(path).parent_path().string();
+    return parent.empty() ? "." : parent;
+}
+
+std::string nameOf(const std::string& path) {
+    return std::filesystem::path(path).filename().string();
+}
+
+} // namespace
+
+// Constructor
+WorldWatcher::WorldWatcher() : fd(-1), imageWatch(-1), sourceWatch(-1) {
+}
+
+// Destructor
+WorldWatcher::~WorldWatcher() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool WorldWatcher::start(const std::string& imagePath, const std::string& sourcePath, std::string& error) {
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        error = std::string("Could not start inotify: ") + std::strerror(errno);
+        return false;
+    }
+    imageName = nameOf(imagePath);
+    sourceName = nameOf(sourcePath);
+
+    // Watching the directories sees files replaced by rename; the same
+    // directory twice gives the same watch descriptor
+    imageWatch = inotify_add_watch(fd, directoryOf(imagePath).c_str(), WORLD_FILE_EVENTS);
+    sourceWatch = inotify_add_watch(fd, directoryOf(sourcePath).c_str(), WORLD_FILE_EVENTS);
+    if (imageWatch < 0 || sourceWatch < 0) {
+        error = "Could not watch " + directoryOf(imageWatch < 0 ? imagePath : sourcePath) + ": " +
+                std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+WorldChanges WorldWatcher::readChanges() {
+    WorldChanges changes;
+    alignas(inotify_event) char buffer[4096];
+    while (true) {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break; // EAGAIN once drained
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0) {
+                std::string name(event->name);
+                if (event->wd == imageWatch && name == imageName) {
+                    changes.image = true;
+                }
+                if (event->wd == sourceWatch && name == sourceName) {
+                    changes.source = true;
+                }
+            }
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+    return changes;
+}
+
+#endif // __linux__
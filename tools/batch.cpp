@@ -0,0 +1,312 @@
+// RoboQuest - A text-based adventure game in C++
+// batch.cpp - Headless batch runner for balance testing
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../include/game.h"
+#include "../include/metrics.h"
+#include "../include/replay.h"
+#include "../include/thread_pool.h"
+#include "../include/turn_scheduler.h"
+
+namespace {
+
+struct Options {
+    size_t sessions = 10000;
+    unsigned threads = 0;
+    Difficulty difficulty = Difficulty::NORMAL;
+    uint64_t seed = 1;
+    int maxTurns = 1000;
+    std::string scriptPath;
+    size_t interleave = 0; // sessions in play at once, turn by turn
+    std::string recordPath;
+    std::string metricsPath;
+};
+
+// Per-worker totals, padded so workers never share a cache line
+struct alignas(64) WorkerStats {
+    uint64_t sessions = 0;
+    uint64_t turns = 0;
+    uint64_t wins = 0;
+    uint64_t scoreSum = 0;
+    int bestScore = 0;
+};
+
+// Small, fast generator for choosing random commands
+uint64_t nextRandom(uint64_t& state) {
+    state += 0x9E3779B97F4A7C15ull;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Where one session has got to
+struct SessionPlay {
+    uint64_t random = 0;
+    int turns = 0;
+    size_t scriptPos = 0;
+};
+
+void startSession(Game& game, const Options& options, size_t session, SessionPlay& play) {
+    game.reset();
+    play.random = options.seed * 0x100000001B3ull + session;
+    play.turns = 0;
+    play.scriptPos = 0;
+}
+
+// Play one turn; false once the session is over
+bool playTurn(Game& game, const Options& options, const std::vector<std::string>& script,
+              SessionPlay& play) {
+    if (!game.isRunning() || play.turns >= options.maxTurns) {
+        return false;
+    }
+    if (!script.empty()) {
+        if (play.scriptPos >= script.size()) return false;
+        game.step(game.parse(script[play.scriptPos++]));
+    } else {
+        // Pick any menu action except quitting
+        const std::vector<std::string>& actions = game.availableActions();
+        size_t pick = nextRandom(play.random) % (actions.size() - 1);
+        game.step(game.parse(actions[pick]));
+    }
+    play.turns++;
+    return true;
+}
+
+void recordSession(const Game& game, const SessionPlay& play, WorkerStats& local) {
+    local.sessions++;
+    local.turns += play.turns;
+    local.wins += game.hasWon() ? 1 : 0;
+    local.scoreSum += game.getScore();
+    local.bestScore = std::max(local.bestScore, game.getScore());
+}
+
+void printUsage() {
+    std::cerr << "Usage: RoboQuest_batch [options]\n"
+              << "  --sessions N      number of sessions to play (default 10000)\n"
+              << "  --threads N       worker threads (default: one per core)\n"
+              << "  --difficulty D    easy, normal or hard (default normal)\n"
+              << "  --seed N          seed for random play (default 1)\n"
+              << "  --max-turns N     turn limit per session (default 1000)\n"
+              << "  --script FILE     play the commands in FILE instead of random ones\n"
+              << "  --interleave N    keep N sessions in play at once and schedule them\n"
+              << "                    turn by turn on a work-stealing scheduler\n"
+              << "  --record FILE     append every session to a replay file\n"
+              << "  --metrics FILE    write turn metrics on exit (JSON for *.json; needs\n"
+              << "                    a ROBOQUEST_METRICS build)\n";
+}
+
+bool parseOptions(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--sessions") options.sessions = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--threads") options.threads = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (arg == "--seed") options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--max-turns") options.maxTurns = std::atoi(value.c_str());
+        else if (arg == "--script") options.scriptPath = value;
+        else if (arg == "--interleave") options.interleave = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--record") options.recordPath = value;
+        else if (arg == "--metrics") options.metricsPath = value;
+        else if (arg == "--difficulty") {
+            if (value == "easy") options.difficulty = Difficulty::EASY;
+            else if (value == "normal") options.difficulty = Difficulty::NORMAL;
+            else if (value == "hard") options.difficulty = Difficulty::HARD;
+            else return false;
+        }
+        else return false;
+    }
+    return true;
+}
+
+bool loadScript(const std::string& path, std::vector<std::string>& script) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        script.push_back(line);
+    }
+    return true;
+}
+
+// Play every session as a series of single turns. Each of the sessions in
+// play has its own game; when one ends, its game moves on to the next
+// unplayed session.
+double playInterleaved(const Options& options, const std::vector<std::string>& script, ReplayWriter& writer,
+                       std::vector<WorkerStats>& stats, unsigned& threads, SchedulerStats& schedulerStats) {
+    struct Slot {
+        std::unique_ptr<ReplayRecorder> recorder; // outlives the game
+        std::unique_ptr<Game> game;
+        TurnScheduler::Session* session;
+        SessionPlay play;
+    };
+
+    TurnScheduler scheduler(options.threads);
+    threads = scheduler.size();
+    NullSink discard;
+    size_t slotCount = std::min(options.interleave, options.sessions);
+    std::vector<Slot> slots(slotCount);
+    stats.assign(slotCount, WorkerStats());
+    std::shared_ptr<const GameWorld> world; // loaded by the first game
+    for (Slot& slot : slots) {
+        slot.game = std::make_unique<Game>();
+        slot.game->setDifficulty(options.difficulty);
+        slot.game->setOutput(discard);
+        if (writer.isOpen()) {
+            slot.recorder = std::make_unique<ReplayRecorder>(writer);
+            slot.game->setRecorder(slot.recorder.get());
+        }
+        if (world) {
+            slot.game->setWorld(world);
+        }
+        if (!slot.game->initialize()) {
+            return -1.0;
+        }
+        world = slot.game->sharedWorld();
+        slot.session = &scheduler.addSession();
+    }
+
+    std::atomic<size_t> nextSession(slotCount);
+    std::function<void(size_t)> turn = [&](size_t index) {
+        Slot& slot = slots[index];
+        if (!playTurn(*slot.game, options, script, slot.play)) {
+            recordSession(*slot.game, slot.play, stats[index]);
+            size_t session = nextSession.fetch_add(1);
+            if (session >= options.sessions) {
+                return;
+            }
+            startSession(*slot.game, options, session, slot.play);
+        }
+        scheduler.submit(*slot.session, [&turn, index] { turn(index); });
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < slotCount; i++) {
+        startSession(*slots[i].game, options, i, slots[i].play);
+        scheduler.submit(*slots[i].session, [&turn, i] { turn(i); });
+    }
+    scheduler.wait();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    schedulerStats = scheduler.stats();
+    return seconds;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+    if (!options.metricsPath.empty()) {
+        dumpMetricsAtExit(options.metricsPath);
+    }
+
+    std::vector<std::string> script;
+    if (!options.scriptPath.empty() && !loadScript(options.scriptPath, script)) {
+        std::cerr << "error: could not read script " << options.scriptPath << std::endl;
+        return 1;
+    }
+
+    ReplayWriter writer;
+    std::string error;
+    if (!options.recordPath.empty() && !writer.open(options.recordPath, error)) {
+        std::cerr << "error: " << error << std::endl;
+        return 1;
+    }
+
+    std::vector<WorkerStats> stats;
+    unsigned threads = 0;
+    SchedulerStats schedulerStats = {0, 0, 0, 0};
+    double seconds;
+    if (options.interleave > 0) {
+        seconds = playInterleaved(options, script, writer, stats, threads, schedulerStats);
+        if (seconds < 0) {
+            return 1;
+        }
+    } else {
+        ThreadPool pool(options.threads);
+        threads = pool.size();
+
+        // One reusable game per worker; sessions only reset it
+        std::vector<std::unique_ptr<ReplayRecorder>> recorders;
+        std::vector<std::unique_ptr<Game>> games;
+        NullSink discard;
+        for (unsigned i = 0; i < pool.size(); i++) {
+            games.push_back(std::make_unique<Game>());
+            games.back()->setDifficulty(options.difficulty);
+            games.back()->setOutput(discard);
+            if (writer.isOpen()) {
+                recorders.push_back(std::make_unique<ReplayRecorder>(writer));
+                games.back()->setRecorder(recorders.back().get());
+            }
+            if (i > 0) {
+                games.back()->setWorld(games.front()->sharedWorld());
+            }
+            if (!games.back()->initialize()) {
+                return 1;
+            }
+        }
+        stats.resize(pool.size());
+
+        auto start = std::chrono::steady_clock::now();
+
+        pool.parallelFor(options.sessions, 64, [&](size_t begin, size_t end, unsigned worker) {
+            Game& game = *games[worker];
+            WorkerStats& local = stats[worker];
+            SessionPlay play;
+            for (size_t session = begin; session < end; session++) {
+                startSession(game, options, session, play);
+                while (playTurn(game, options, script, play)) {
+                }
+                recordSession(game, play, local);
+            }
+        });
+
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    WorkerStats total;
+    for (const auto& worker : stats) {
+        total.sessions += worker.sessions;
+        total.turns += worker.turns;
+        total.wins += worker.wins;
+        total.scoreSum += worker.scoreSum;
+        total.bestScore = std::max(total.bestScore, worker.bestScore);
+    }
+
+    double sessions = static_cast<double>(std::max<uint64_t>(1, total.sessions));
+    std::cout << "sessions:      " << total.sessions << "\n"
+              << "threads:       " << threads << "\n"
+              << "turns:         " << total.turns << "\n"
+              << "wins:          " << total.wins << " (" << (100.0 * total.wins / sessions) << "%)\n"
+              << "average score: " << (total.scoreSum / sessions) << "\n"
+              << "best score:    " << total.bestScore << "\n"
+              << "elapsed:       " << seconds << " s\n"
+              << "turns/minute:  " << static_cast<uint64_t>(total.turns / std::max(seconds, 1e-9) * 60.0) << std::endl;
+    if (options.interleave > 0) {
+        double dispatches = static_cast<double>(std::max<uint64_t>(1, schedulerStats.dispatches));
+        std::cout << "dispatches:    " << schedulerStats.dispatches
+                  << " (" << (100.0 * schedulerStats.homeRuns / dispatches) << "% on the same worker)\n"
+                  << "steals:        " << schedulerStats.steals << std::endl;
+    }
+    return 0;
+}
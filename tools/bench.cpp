@@ -0,0 +1,424 @@
+// RoboQuest - A text-based adventure game in C++
+// bench.cpp - Micro-benchmarks for the game's hot paths
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../include/game.h"
+#include "../include/json_handler.h"
+#include "../include/metrics.h"
+#include "../include/script_vm.h"
+#include "../include/world_compiler.h"
+
+namespace {
+
+struct Options {
+    std::string filter;
+    int milliseconds = 100; // per measurement
+    int repeat = 5;         // measurements per benchmark; the median is shown
+    std::string directory;  // for score stores
+};
+
+void printUsage() {
+    std::cerr << "Usage: RoboQuest_bench [options]\n"
+              << "  --filter TEXT     run only benchmarks whose name contains TEXT\n"
+              << "  --time MS         time per measurement (default 100)\n"
+              << "  --repeat N        measurements per benchmark, median shown (default 5)\n"
+              << "  --dir PATH        directory for the score stores (default: temp)\n"
+              << "Run from the build directory so data/facility.rqw is found.\n";
+}
+
+// Keeps results alive so the compiler cannot drop the work
+volatile uint64_t blackHole;
+
+// Accepts game text, so it is formatted as usual, and throws it away
+class CountingSink : public OutputSink {
+public:
+    uint64_t bytes = 0;
+
+    void write(const char*, size_t size) override {
+        bytes += size;
+    }
+};
+
+// The same for std::ostream users
+class CountingBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override {
+        blackHole = blackHole + 1;
+        return c;
+    }
+
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        blackHole = blackHole + static_cast<uint64_t>(count);
+        return count;
+    }
+};
+
+class Bench {
+private:
+    const Options& options;
+
+public:
+    explicit Bench(const Options& benchOptions) : options(benchOptions) {
+        std::printf("%-36s %-14s %12s %12s\n", "benchmark", "size", "ns/op", "allocs/op");
+    }
+
+    // Whether any of the named benchmarks passes the filter, to skip
+    // expensive setup for groups that will not run
+    bool wants(std::initializer_list<const char*> names) const {
+        for (const char* name : names) {
+            if (options.filter.empty() || std::string(name).find(options.filter) != std::string::npos) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Time op(i) for i = 0, 1, 2, ... Iterations are calibrated so one
+    // measurement takes about options.milliseconds.
+    template <typename Op>
+    void run(const std::string& name, const std::string& size, Op&& op) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+            return;
+        }
+
+        using Clock = std::chrono::steady_clock;
+        uint64_t index = 0;
+        auto timeBatch = [&](uint64_t iterations) {
+            auto start = Clock::now();
+            for (uint64_t n = 0; n < iterations; n++) {
+                op(index++);
+            }
+            return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        };
+
+        uint64_t iterations = 1;
+        double elapsed = timeBatch(iterations);
+        while (elapsed < options.milliseconds * 1e5 && iterations < (uint64_t(1) << 40)) {
+            iterations *= 2;
+            elapsed = timeBatch(iterations);
+        }
+        iterations = std::max<uint64_t>(1, static_cast<uint64_t>(iterations * options.milliseconds * 1e6 / std::max(elapsed, 1.0)));
+
+        std::vector<double> samples;
+        uint64_t allocations = 0;
+        for (int r = 0; r < options.repeat; r++) {
+            uint64_t before = threadAllocationCount();
+            samples.push_back(timeBatch(iterations) / iterations);
+            allocations = threadAllocationCount() - before;
+        }
+        std::sort(samples.begin(), samples.end());
+        std::printf("%-36s %-14s %12.1f %12.2f\n", name.c_str(), size.c_str(),
+                    samples[samples.size() / 2], static_cast<double>(allocations) / iterations);
+        std::fflush(stdout);
+    }
+};
+
+// A square grid of rooms, every room open to its neighbours; rooms spaced
+// further apart than 1 make a sparse map with a hashed room index
+bool gridWorld(int side, int spacing, World& world) {
+    std::ostringstream source;
+    source << "start r0_0\ngoal r" << side - 1 << "_" << side - 1 << "\n";
+    for (int y = 0; y < side; y++) {
+        for (int x = 0; x < side; x++) {
+            source << "room r" << x << "_" << y << " " << x * spacing << " " << y * spacing << "\n"
+                   << "    name Room " << x << "," << y << "\n"
+                   << "    desc Room " << x << "," << y << "\n"
+                   << "end\n";
+        }
+    }
+
+    std::istringstream input(source.str());
+    std::vector<char> image;
+    WorldCompiler compiler;
+    std::string error;
+    if (!compiler.compile(input, "grid", image) || !world.loadBuffer(std::move(image), error)) {
+        std::cerr << "error: could not build a grid world: " << compiler.lastError() << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void benchWorld(Bench& bench) {
+    struct Layout {
+        int side;
+        int spacing;
+    };
+    for (Layout layout : {Layout{4, 1}, Layout{32, 1}, Layout{256, 1}, Layout{32, 1000}}) {
+        int side = layout.side;
+        World world;
+        if (!gridWorld(side, layout.spacing, world)) {
+            return;
+        }
+        std::string size = std::to_string(side * side) + (layout.spacing > 1 ? " sparse" : " rooms");
+
+        // Random cells from a slightly larger area, so some lookups miss
+        std::vector<int> cells(4096);
+        uint64_t random = 1;
+        for (int& cell : cells) {
+            random = random * 6364136223846793005ull + 1442695040888963407ull;
+            cell = static_cast<int>((random >> 33) % ((side + 2) * (side + 2)));
+        }
+        bench.run("world.findRoom", size, [&](uint64_t i) {
+            int cell = cells[i & 4095];
+            blackHole = static_cast<uint64_t>(world.findRoom((cell % (side + 2) - 1) * layout.spacing,
+                                                             (cell / (side + 2) - 1) * layout.spacing));
+        });
+
+        int rooms = world.roomCount();
+        bench.run("world.neighbor", size, [&](uint64_t i) {
+            int room = cells[i & 4095] % rooms;
+            blackHole = static_cast<uint64_t>(world.neighbor(room, static_cast<Direction>(i & 3)));
+        });
+    }
+}
+
+// Play commands from the start and return the state they lead to
+GameState prepare(Game& game, std::initializer_list<const char*> commands) {
+    game.reset();
+    for (const char* command : commands) {
+        game.step(game.parse(command));
+    }
+    return game.snapshot();
+}
+
+void benchGame(Bench& bench) {
+    CountingSink sink;
+    Game game;
+    game.setOutput(sink);
+    if (!game.initialize()) {
+        return;
+    }
+
+    GameState start = prepare(game, {});
+    GameState pipeline = prepare(game, {"east", "east"});
+    GameState cardRoom = prepare(game, {"east", "north"});
+    GameState atExit = prepare(game, {"east", "north", "take access_card", "south", "west", "south"});
+    GameState fixer = prepare(game, {"north", "take debugging_ability", "south", "east", "east"});
+
+    bench.run("game.restore", "facility", [&](uint64_t) {
+        game.restore(start);
+    });
+
+    struct RoomCase {
+        const char* name;
+        const GameState* state;
+    };
+    for (const RoomCase& room : {RoomCase{"control room", &start}, RoomCase{"pipeline", &fixer},
+                                 RoomCase{"card room", &cardRoom}}) {
+        game.restore(*room.state);
+        bench.run("game.updateAvailableOptions", room.name, [&](uint64_t) {
+            blackHole = game.availableActions().size();
+        });
+    }
+
+    // Every turn starts from the same state
+    struct VerbCase {
+        const char* name;
+        const char* command;
+        const GameState* state;
+    };
+    const VerbCase verbs[] = {
+        {"north", "north", &start},
+        {"south", "south", &start},
+        {"east", "east", &start},
+        {"west", "west", &start},
+        {"look", "look", &cardRoom},
+        {"inventory", "inventory", &atExit},
+        {"take", "take access_card", &cardRoom},
+        {"use", "use access_card", &atExit},
+        {"help", "help", &start},
+        {"quit", "quit", &start},
+        {"examine_pipeline", "examine pipeline", &pipeline},
+        {"check_version", "check version", &pipeline},
+        {"fix_build", "fix build", &fixer},
+        {"unknown", "dance", &start},
+    };
+    for (const VerbCase& verb : verbs) {
+        Command command = game.parse(verb.command);
+        bench.run(std::string("game.processInput/") + verb.name, "facility", [&](uint64_t) {
+            game.restore(*verb.state);
+            game.step(command);
+        });
+    }
+
+    game.restore(start);
+    bench.run("game.render", "facility", [&](uint64_t) {
+        game.render();
+        game.flushOutput();
+    });
+}
+
+// Takes whatever scripts do outside the state and throws it away
+class SilentHost : public ScriptHost {
+public:
+    void scriptSay(std::string_view text) override {
+        blackHole = blackHole + text.size();
+    }
+
+    void scriptAddTime(int seconds) override {
+        blackHole = blackHole + static_cast<uint64_t>(seconds);
+    }
+
+    void scriptShowMap() override {
+    }
+};
+
+const char* const SCRIPT_WORLD =
+    "room lab 0 0\nend\n"
+    "item key\n    room lab\nend\n"
+    "script loop\n"
+    "    let i = 0\n"
+    "    while i < 1000\n"
+    "        let i = i + 1\n"
+    "    end\n"
+    "end\n"
+    "script alarm\n"
+    "    if flag armed and not has key\n"
+    "        let alarm = alarm - 1\n"
+    "        if alarm <= 0\n"
+    "            say The alarm goes off.\n"
+    "            let alarm = 5\n"
+    "        end\n"
+    "    end\n"
+    "end\n";
+
+// Scripts run straight on the VM: a tight loop, whose time per operation
+// divided by its instruction count is the cost of one instruction, and
+// an every-turn alarm
+void benchScripts(Bench& bench) {
+    if (!bench.wants({"script.run"})) {
+        return;
+    }
+    std::istringstream input(SCRIPT_WORLD);
+    std::vector<char> image;
+    WorldCompiler compiler;
+    World world;
+    std::string error;
+    if (!compiler.compile(input, "scripts", image) || !world.loadBuffer(std::move(image), error) ||
+        !ScriptVM::verify(world, error)) {
+        std::cerr << "error: could not build the script world: " << compiler.lastError() << error << std::endl;
+        return;
+    }
+
+    GameState state;
+    state.room = 0;
+    state.score = 0;
+    state.timeRemaining = 480;
+    state.flags = 1u << (1 + WORLD_FLAG_SHIFT); // armed, the first flag the scripts name
+    state.inventory.clear();
+    state.clearCounters();
+    SilentHost host;
+    ScriptVM vm;
+    for (int script = 0; script < world.scriptCount(); script++) {
+        vm.newTurn();
+        vm.run(world, script, state, host);
+        std::string size = std::to_string(ScriptVM::TURN_BUDGET - vm.budgetLeft()) + " instr";
+        bench.run("script.run/" + std::string(world.text(world.script(script).name)), size, [&](uint64_t) {
+            vm.newTurn();
+            vm.run(world, script, state, host);
+        });
+    }
+}
+
+// A store of count scores, indexed, spread over the difficulties
+bool makeStore(const std::string& path, size_t count) {
+    std::filesystem::remove(path);
+    std::filesystem::remove(path + ".idx");
+    ScoreStore store;
+    store.setDurability(ScoreDurability::NONE);
+    std::string error;
+    if (!store.open(path, error)) {
+        std::cerr << "error: " << error << std::endl;
+        return false;
+    }
+
+    std::vector<ScoreRecord> batch;
+    uint64_t random = 7;
+    for (size_t i = 0; i < count; i++) {
+        random = random * 6364136223846793005ull + 1442695040888963407ull;
+        batch.push_back(makeScoreRecord("Player" + std::to_string(i % 1000), static_cast<int>((random >> 33) % 5000),
+                                        static_cast<ScoreDifficulty>(i % SCORE_DIFFICULTY_COUNT),
+                                        1700000000 + static_cast<int64_t>(i)));
+        if (batch.size() == 65536 || i + 1 == count) {
+            if (!store.appendAll(batch, error)) {
+                std::cerr << "error: " << error << std::endl;
+                return false;
+            }
+            batch.clear();
+        }
+    }
+    return store.buildIndex(error);
+}
+
+void benchScores(Bench& bench, const Options& options) {
+    if (!bench.wants({"scores.loadScores", "scores.displayHighScores", "scores.saveScore"})) {
+        return;
+    }
+    for (size_t count : {100, 10000, 1000000}) {
+        std::string path = options.directory + "/bench_" + std::to_string(count) + ".rqs";
+        if (!makeStore(path, count)) {
+            return;
+        }
+        std::string size = std::to_string(count) + " scores";
+        {
+            JsonHandler handler(path);
+            bench.run("scores.loadScores", size, [&](uint64_t) {
+                handler.loadScores();
+            });
+
+            CountingBuffer buffer;
+            std::ostream out(&buffer);
+            bench.run("scores.displayHighScores", size, [&](uint64_t) {
+                handler.displayHighScores(out);
+            });
+
+            bench.run("scores.saveScore", size, [&](uint64_t i) {
+                handler.saveScore("Bench", static_cast<int>(i % 5000), "Normal");
+            });
+        }
+        std::filesystem::remove(path);
+        std::filesystem::remove(path + ".idx");
+        std::filesystem::remove(path + ".lock");
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--filter") options.filter = value;
+        else if (arg == "--time") options.milliseconds = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--repeat") options.repeat = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--dir") options.directory = value;
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+    if (options.directory.empty()) {
+        options.directory = std::filesystem::temp_directory_path().string();
+    }
+
+    Bench bench(options);
+    benchWorld(bench);
+    benchGame(bench);
+    benchScripts(bench);
+    benchScores(bench, options);
+    return 0;
+}
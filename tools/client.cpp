@@ -0,0 +1,175 @@
+// RoboQuest - A text-based adventure game in C++
+// client.cpp - Loopback client for playing on and load testing the server
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 7777;
+    std::string unixPath;
+    size_t idleSessions = 0; // load test instead of playing
+    int holdSeconds = 5;
+};
+
+void printUsage() {
+    std::cerr << "Usage: RoboQuest_client [options]\n"
+              << "  --port N          TCP port (default 7777)\n"
+              << "  --host ADDRESS    server address (default 127.0.0.1)\n"
+              << "  --unix PATH       connect to a Unix socket instead\n"
+              << "  --idle N          open N sessions, keep them idle, then quit each\n"
+              << "  --hold S          seconds to keep idle sessions open (default 5)\n"
+              << "Without --idle the terminal is connected to one session.\n";
+}
+
+int connectToServer(const Options& options) {
+    if (!options.unixPath.empty()) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options.unixPath.c_str(), sizeof(address.sun_path) - 1);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            return fd;
+        }
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    sockaddr_in address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(options.port));
+    inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        return fd;
+    }
+    if (fd >= 0) close(fd);
+    return -1;
+}
+
+bool sendText(int fd, const std::string& text) {
+    size_t sent = 0;
+    while (sent < text.size()) {
+        ssize_t n = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Copy the terminal to the session and back until either side closes
+int play(const Options& options) {
+    int fd = connectToServer(options);
+    if (fd < 0) {
+        std::cerr << "Error: Could not connect to the server" << std::endl;
+        return 1;
+    }
+
+    pollfd watched[2] = {{STDIN_FILENO, POLLIN, 0}, {fd, POLLIN, 0}};
+    char buffer[4096];
+    while (poll(watched, 2, -1) > 0) {
+        if (watched[1].revents & (POLLIN | POLLHUP)) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n <= 0) break;
+            std::cout.write(buffer, n).flush();
+        }
+        if (watched[0].revents & (POLLIN | POLLHUP)) {
+            ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+            if (n <= 0) {
+                shutdown(fd, SHUT_WR);
+                watched[0].fd = -1;
+            } else if (!sendText(fd, std::string(buffer, n))) {
+                break;
+            }
+        }
+    }
+    close(fd);
+    return 0;
+}
+
+// Read until the server closes the connection
+std::string readAll(int fd) {
+    std::string text;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        text.append(buffer, n);
+    }
+    return text;
+}
+
+// Open many sessions, leave them idle, then quit each one and check that
+// every session answered
+int holdIdle(const Options& options) {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<int> sessions;
+    for (size_t i = 0; i < options.idleSessions; i++) {
+        int fd = connectToServer(options);
+        if (fd < 0 || !sendText(fd, "idle" + std::to_string(i) + "\n2\n")) {
+            std::cerr << "Error: Could not open session " << i << std::endl;
+            break;
+        }
+        sessions.push_back(fd);
+    }
+    double opening = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "opened " << sessions.size() << " sessions in " << opening << " s" << std::endl;
+
+    std::this_thread::sleep_for(std::chrono::seconds(options.holdSeconds));
+
+    size_t answered = 0;
+    for (int fd : sessions) {
+        if (sendText(fd, "8\ny\n") && readAll(fd).find("Thanks for playing!") != std::string::npos) {
+            answered++;
+        }
+        close(fd);
+    }
+    std::cout << "quit " << answered << " of " << sessions.size() << " sessions" << std::endl;
+    return answered == options.idleSessions ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--port") options.port = std::atoi(value.c_str());
+        else if (arg == "--host") options.host = value;
+        else if (arg == "--unix") options.unixPath = value;
+        else if (arg == "--idle") options.idleSessions = std::strtoul(value.c_str(), nullptr, 10);
+        else if (arg == "--hold") options.holdSeconds = std::atoi(value.c_str());
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    return options.idleSessions > 0 ? holdIdle(options) : play(options);
+}
@@ -0,0 +1,119 @@
+// RoboQuest - A text-based adventure game in C++
+// replay.cpp - Replays recorded sessions and checks their outcome
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../include/game.h"
+#include "../include/metrics.h"
+#include "../include/replay.h"
+#include "../include/session_clock.h"
+#include "../include/thread_pool.h"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: RoboQuest_replay <recording.rqr> [options]\n"
+              << "  --threads N       worker threads (default: one per core)\n"
+              << "  --show N          list at most N mismatched sessions (default 10)\n"
+              << "  --metrics FILE    write turn metrics on exit (JSON for *.json)\n";
+}
+
+// Per-worker game and clock, padded so workers never share a cache line
+struct alignas(64) Replayer {
+    std::unique_ptr<Game> game;
+    std::unique_ptr<SessionClock> clock;
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 2;
+    }
+    std::string path = argv[1];
+    unsigned threads = 0;
+    size_t show = 10;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--threads") threads = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (arg == "--show") show = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--metrics") dumpMetricsAtExit(value);
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<ReplaySession> sessions;
+    std::string error;
+    if (!readReplays(path, sessions, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+    double loading = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    ThreadPool pool(threads);
+    NullSink discard;
+    std::vector<Replayer> replayers(pool.size());
+    for (Replayer& replayer : replayers) {
+        replayer.game = std::make_unique<Game>();
+        replayer.game->setOutput(discard);
+        if (&replayer != &replayers.front()) {
+            replayer.game->setWorld(replayers.front().game->sharedWorld());
+        }
+        if (!replayer.game->initialize()) {
+            return 1;
+        }
+        replayer.clock = std::make_unique<SessionClock>();
+    }
+
+    std::vector<ReplayResult> results(sessions.size());
+    start = std::chrono::steady_clock::now();
+    pool.parallelFor(sessions.size(), 256, [&](size_t begin, size_t end, unsigned worker) {
+        Replayer& replayer = replayers[worker];
+        for (size_t i = begin; i < end; i++) {
+            results[i] = replaySession(*replayer.game, *replayer.clock, sessions[i]);
+        }
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t turns = 0;
+    size_t mismatched = 0;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        turns += sessions[i].commands.size();
+        if (results[i].matched) {
+            continue;
+        }
+        if (mismatched++ < show) {
+            std::cout << "session " << i << " (" << sessions[i].playerName << "): ";
+            if (!results[i].sameWorld) {
+                std::cout << "recorded on a different world\n";
+            } else {
+                std::cout << "score " << results[i].score << " (recorded " << sessions[i].score
+                          << "), state " << std::hex << results[i].stateHash << " (recorded "
+                          << sessions[i].stateHash << ")" << std::dec << "\n";
+            }
+        }
+    }
+
+    std::cout << "sessions:      " << sessions.size() << " (read in " << loading << " s)\n"
+              << "turns:         " << turns << "\n"
+              << "matched:       " << (sessions.size() - mismatched) << "\n"
+              << "mismatched:    " << mismatched << "\n"
+              << "threads:       " << pool.size() << "\n"
+              << "elapsed:       " << seconds << " s\n"
+              << "turns/second:  " << static_cast<uint64_t>(turns / std::max(seconds, 1e-9)) << std::endl;
+    return mismatched == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+// RoboQuest - A text-based adventure game in C++
+// scores.cpp - Converts and queries binary score stores
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../include/json_handler.h"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: RoboQuest_scores <command> <store.rqs> [options]\n"
+              << "  import <store> <log.txt>   append the scores of a text score log\n"
+              << "  add <store> <name> <score> <D>  append one score for difficulty D\n"
+              << "  index <store>              rebuild the score and date indexes\n"
+              << "  top <store> [D] [N]        best N scores (default 10), optionally for\n"
+              << "                             difficulty D (Easy, Normal or Hard)\n"
+              << "  export <store>             print every score as a text log line\n";
+}
+
+void printRecord(const ScoreRecord& record) {
+    ScoreEntry entry = JsonHandler::toEntry(record);
+    std::cout << entry.playerName << "," << entry.score << ","
+              << entry.difficulty << "," << entry.date << "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage();
+        return 2;
+    }
+    std::string command = argv[1];
+    std::string path = argv[2];
+
+    JsonHandler handler(path);
+    const ScoreStore& store = handler.scoreStore();
+    if (!store.isOpen()) {
+        return 1;
+    }
+
+    if (command == "import" && argc == 4) {
+        auto start = std::chrono::steady_clock::now();
+        long imported = handler.importLog(argv[3]);
+        if (imported < 0) {
+            std::cerr << "Error: Could not open " << argv[3] << std::endl;
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Imported " << imported << " scores in " << seconds << " s ("
+                  << store.recordCount() << " in store)\n";
+    }
+    else if (command == "add" && argc == 6) {
+        ScoreDifficulty difficulty;
+        if (!parseScoreDifficulty(argv[5], difficulty)) {
+            printUsage();
+            return 2;
+        }
+        if (!handler.saveScore(argv[3], std::atoi(argv[4]), argv[5])) {
+            return 1;
+        }
+    }
+    else if (command == "index" && argc == 3) {
+        if (!handler.compact()) {
+            return 1;
+        }
+        std::cout << "Indexed " << store.recordCount() << " scores\n";
+    }
+    else if (command == "top" && argc <= 5) {
+        size_t count = 10;
+        std::vector<uint32_t> ranked;
+        ScoreDifficulty difficulty;
+        if (argc >= 4 && parseScoreDifficulty(argv[3], difficulty)) {
+            if (argc == 5) count = std::strtoul(argv[4], nullptr, 10);
+            store.top(difficulty, count, ranked);
+        } else {
+            if (argc == 5) {
+                printUsage();
+                return 2;
+            }
+            if (argc == 4) count = std::strtoul(argv[3], nullptr, 10);
+            store.top(count, ranked);
+        }
+        for (size_t i = 0; i < ranked.size(); i++) {
+            std::cout << (i + 1) << ". ";
+            printRecord(store.record(ranked[i]));
+        }
+        if (store.unindexedCount() > 0) {
+            std::cerr << store.unindexedCount() << " scores are not indexed yet\n";
+        }
+    }
+    else if (command == "export" && argc == 3) {
+        std::cout << SCORE_LOG_HEADER << "\n";
+        for (uint32_t i = 0; i < store.recordCount(); i++) {
+            if (scoreRecordValid(store.record(i))) {
+                printRecord(store.record(i));
+            }
+        }
+    }
+    else {
+        printUsage();
+        return 2;
+    }
+    return 0;
+}
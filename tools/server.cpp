@@ -0,0 +1,153 @@
+// RoboQuest - A text-based adventure game in C++
+// server.cpp - Serves RoboQuest sessions over TCP or a Unix socket
+
+#include <atomic>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <pthread.h>
+#include <string>
+#include <sys/resource.h>
+#include <thread>
+#include "../include/game_server.h"
+#include "../include/metrics.h"
+
+namespace {
+
+GameServer* activeServer = nullptr;
+
+void handleSignal(int) {
+    if (activeServer != nullptr) {
+        activeServer->stop();
+    }
+}
+
+void printUsage() {
+    std::cerr << "Usage: RoboQuest_server [options]\n"
+              << "  --port N          TCP port (default 7777)\n"
+              << "  --host ADDRESS    IPv4 address to listen on (default 127.0.0.1)\n"
+              << "  --unix PATH       listen on a Unix socket instead of TCP\n"
+              << "  --scores PATH     record final scores in this score store\n"
+              << "  --record PATH     append every game to this replay file\n"
+              << "  --watch           reload the world when data/facility.rqw or .world changes\n"
+              << "  --metrics PATH    write turn metrics here on SIGUSR1 and on exit\n"
+              << "                    (JSON for *.json; needs a ROBOQUEST_METRICS build)\n";
+}
+
+// Every session needs a descriptor, so allow as many as the system lets us
+void raiseDescriptorLimit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+// Writes the metrics each time SIGUSR1 arrives. The counters are lock-free,
+// so they are read while the server keeps running.
+class MetricsDumper {
+private:
+    std::string path;
+    sigset_t signals;
+    std::atomic<bool> done;
+    std::thread thread;
+
+    void loop() {
+        int signal = 0;
+        while (sigwait(&signals, &signal) == 0 && !done) {
+            std::string error;
+            if (!writeMetricsFile(path, error)) {
+                std::cerr << "Error: " << error << std::endl;
+            }
+        }
+    }
+
+public:
+    // Must be started before any other thread so they all block SIGUSR1
+    explicit MetricsDumper(const std::string& target) : path(target), done(false) {
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGUSR1);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+        thread = std::thread(&MetricsDumper::loop, this);
+    }
+
+    ~MetricsDumper() {
+        done = true;
+        pthread_kill(thread.native_handle(), SIGUSR1);
+        thread.join();
+        std::string error;
+        if (!writeMetricsFile(path, error)) {
+            std::cerr << "Error: " << error << std::endl;
+        }
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    ServerOptions options;
+    std::string scoresPath;
+    std::string recordPath;
+    std::string metricsPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--watch") {
+            options.watchWorld = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--port") options.port = std::atoi(value.c_str());
+        else if (arg == "--host") options.host = value;
+        else if (arg == "--unix") options.unixPath = value;
+        else if (arg == "--scores") scoresPath = value;
+        else if (arg == "--record") recordPath = value;
+        else if (arg == "--metrics") metricsPath = value;
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    raiseDescriptorLimit();
+    std::unique_ptr<MetricsDumper> metricsDumper;
+    if (!metricsPath.empty()) {
+        metricsDumper.reset(new MetricsDumper(metricsPath));
+    }
+    std::unique_ptr<JsonHandler> scoreHandler;
+    if (!scoresPath.empty()) {
+        scoreHandler.reset(new JsonHandler(scoresPath));
+    }
+
+    std::string error;
+    ReplayWriter replayWriter;
+    if (!recordPath.empty() && !replayWriter.open(recordPath, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    GameServer server(options);
+    server.setScoreHandler(scoreHandler.get());
+    server.setReplayWriter(replayWriter.isOpen() ? &replayWriter : nullptr);
+    if (!server.start(error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    activeServer = &server;
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+    std::cout << "Serving RoboQuest on "
+              << (options.unixPath.empty() ? options.host + ":" + std::to_string(options.port) : options.unixPath)
+              << std::endl;
+
+    server.run();
+    activeServer = nullptr;
+    std::cout << "Server stopped" << std::endl;
+    return 0;
+}
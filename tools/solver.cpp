@@ -0,0 +1,111 @@
+// RoboQuest - A text-based adventure game in C++
+// solver.cpp - Reports the best achievable routes through the facility
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../include/solver.h"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "Usage: RoboQuest_solver [options]\n"
+              << "  --difficulty D    easy, normal or hard (default: all three)\n"
+              << "  --max-turns N     search horizon in turns (default 60)\n"
+              << "  --max-states N    stop after keeping N states (default 5000000)\n"
+              << "  --threads N       worker threads (default: one per core)\n";
+}
+
+void printPath(const std::vector<std::string>& path) {
+    for (size_t i = 0; i < path.size(); i++) {
+        std::cout << (i == 0 ? "" : ", ") << path[i];
+    }
+    std::cout << "\n";
+}
+
+const char* difficultyName(Difficulty difficulty) {
+    switch (difficulty) {
+        case Difficulty::EASY:
+            return "Easy";
+        case Difficulty::HARD:
+            return "Hard";
+        default:
+            return "Normal";
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    SolverOptions options;
+    unsigned threads = 0;
+    std::vector<Difficulty> difficulties = {Difficulty::EASY, Difficulty::NORMAL, Difficulty::HARD};
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return 2;
+        }
+        std::string value = argv[++i];
+        if (arg == "--max-turns") options.maxTurns = std::atoi(value.c_str());
+        else if (arg == "--max-states") options.maxStates = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--threads") threads = static_cast<unsigned>(std::strtoul(value.c_str(), nullptr, 10));
+        else if (arg == "--difficulty" && value == "easy") difficulties = {Difficulty::EASY};
+        else if (arg == "--difficulty" && value == "normal") difficulties = {Difficulty::NORMAL};
+        else if (arg == "--difficulty" && value == "hard") difficulties = {Difficulty::HARD};
+        else {
+            printUsage();
+            return 2;
+        }
+    }
+
+    ThreadPool pool(threads);
+    RouteSolver solver(pool);
+    int exitCode = 0;
+
+    for (Difficulty difficulty : difficulties) {
+        options.difficulty = difficulty;
+        SolverResult result;
+
+        auto start = std::chrono::steady_clock::now();
+        if (!solver.solve(options, result)) {
+            return 1;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "== " << difficultyName(difficulty) << " ==\n"
+                  << "states kept " << result.statesKept << ", expanded " << result.statesExpanded
+                  << ", " << result.layers << " turns, " << seconds << " s on " << pool.size() << " threads\n";
+
+        if (result.winnable) {
+            std::cout << "shortest win: " << result.shortestWin.size() << " turns, score "
+                      << result.shortestWinScore << "\n  ";
+            printPath(result.shortestWin);
+            std::cout << "best winning score: " << result.bestWinScore << " in "
+                      << result.bestWin.size() << " turns\n  ";
+            printPath(result.bestWin);
+        } else {
+            std::cout << "no winning route found\n";
+            exitCode = 1;
+        }
+        std::cout << "best score in any state: " << result.bestScore << "\n";
+
+        if (!result.scoreLoop.empty()) {
+            std::cout << "warning: score grows without limit by repeating: ";
+            printPath(result.scoreLoop);
+        }
+        if (!result.pruned) {
+            std::cout << "note: scripts read the time or score, so states were not pruned on them\n";
+        }
+        if (result.truncated) {
+            std::cout << "note: search stopped at the horizon; scores are the best within "
+                      << result.layers << " turns\n";
+        }
+        std::cout << std::endl;
+    }
+
+    return exitCode;
+}
@@ -0,0 +1,52 @@
+// RoboQuest - A text-based adventure game in C++
+// worldc.cpp - Offline compiler from world source files to binary images
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../include/world.h"
+#include "../include/world_compiler.h"
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: RoboQuest_worldc <input.world> <output.rqw>" << std::endl;
+        return 2;
+    }
+
+    std::string input = argv[1];
+    std::string output = argv[2];
+
+    WorldCompiler compiler;
+    std::vector<char> image;
+    if (!compiler.compileFile(input, image)) {
+        std::cerr << "error: " << compiler.lastError() << std::endl;
+        return 1;
+    }
+
+    // Write to a temporary file first so a running game never maps a half-written image
+    std::string temporary = output + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(image.data(), static_cast<std::streamsize>(image.size()))) {
+            std::cerr << "error: could not write " << temporary << std::endl;
+            return 1;
+        }
+    }
+#ifdef _WIN32
+    std::remove(output.c_str()); // rename does not replace existing files on Windows
+#endif
+    if (std::rename(temporary.c_str(), output.c_str()) != 0) {
+        std::cerr << "error: could not replace " << output << std::endl;
+        return 1;
+    }
+
+    const WorldImageHeader* header = reinterpret_cast<const WorldImageHeader*>(image.data());
+    std::cout << output << ": " << header->roomCount << " rooms, "
+              << header->itemCount << " items, "
+              << header->ruleCount << " interactions, "
+              << header->scriptCount << " scripts, "
+              << image.size() << " bytes" << std::endl;
+    return 0;
+}